@@ -0,0 +1,274 @@
+#include "BatchProcessor.h"
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <iterator>
+
+namespace ofxKinectForWindows2 {
+
+	namespace {
+
+		// runs a fixed set of tasks on nThreads, each worker has its own deque:
+		// own tasks are popped from the back, idle workers steal from the front of the others
+		// no tasks are added while running, so once every deque is empty the work is done
+		void runWorkStealing(vector<std::function<void()>>& tasks, int nThreads) {
+
+			if (tasks.empty()) return;
+			nThreads = std::max(1, std::min(nThreads, (int)tasks.size()));
+
+			struct Queue {
+				std::mutex mutex;
+				std::deque<size_t> tasks;
+			};
+			vector<Queue> queues(nThreads);
+			for (size_t t = 0; t < tasks.size(); t++) queues[t % nThreads].tasks.push_back(t);
+
+			auto worker = [&](int self) {
+				while (true) {
+					size_t task = 0;
+					bool found = false;
+					{
+						std::lock_guard<std::mutex> lock(queues[self].mutex);
+						if (!queues[self].tasks.empty()) {
+							task = queues[self].tasks.back();
+							queues[self].tasks.pop_back();
+							found = true;
+						}
+					}
+					for (int k = 1; !found && k < nThreads; k++) {
+						Queue& victim = queues[(self + k) % nThreads];
+						std::lock_guard<std::mutex> lock(victim.mutex);
+						if (!victim.tasks.empty()) {
+							task = victim.tasks.front();
+							victim.tasks.pop_front();
+							found = true;
+						}
+					}
+					if (!found) return;
+					tasks[task]();
+				}
+			};
+
+			vector<std::thread> threads;
+			for (int i = 1; i < nThreads; i++) threads.emplace_back(worker, i);
+			worker(0);
+			for (auto& t : threads) t.join();
+		}
+	}
+
+	int BatchProcessor::addRecording(ReaderFactory factory) {
+		_recordings.push_back(factory);
+		return (int)_recordings.size() - 1;
+	}
+
+	bool BatchProcessor::run() {
+
+		_results.clear();
+		_elapsed = 0;
+
+		if (_recordings.empty()) {
+			ofLogError("BatchProcessor::run") << "nothing to process, no recordings added";
+			return false;
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		// cut recordings into shards
+		vector<Shard> shards;
+		for (int r = 0; r < (int)_recordings.size(); r++) {
+			auto reader = _recordings[r]();
+			if (!reader) {
+				ofLogError("BatchProcessor::run") << "couldn't open recording " << r;
+				return false;
+			}
+			size_t n = reader->getNumFrames();
+			size_t len = _shardLength ? _shardLength : std::max<size_t>(n, 1);
+			for (size_t b = 0; b < n; b += len) {
+				Shard shard;
+				shard.recording = r;
+				shard.begin = b;
+				shard.end = std::min(n, b + len);
+				shard.first = b > _warmupFrames ? b - _warmupFrames : 0;
+				shards.push_back(shard);
+			}
+		}
+
+		// users tracked across shard boundaries: start times, one sequential pass per recording
+		std::atomic<bool> ok(true);
+		vector<std::function<void()>> tasks;
+		for (int r = 0; r < (int)_recordings.size(); r++) {
+			vector<Shard*> recShards;
+			for (auto& shard : shards) {
+				if (shard.recording == r && shard.first > 0) recShards.push_back(&shard);
+			}
+			if (recShards.empty()) continue;
+			tasks.push_back([&, r, recShards]() mutable {
+				if (!findStartTimes(r, recShards)) ok = false;
+			});
+		}
+		runWorkStealing(tasks, _numThreads);
+		if (!ok) return false;
+		tasks.clear();
+
+		// every shard writes its own results, merged in order below
+		vector<vector<FrameResult>> shardResults(shards.size());
+		for (size_t i = 0; i < shards.size(); i++) {
+			tasks.push_back([&, i]() {
+				if (!processShard(shards[i], shardResults[i])) ok = false;
+			});
+		}
+		runWorkStealing(tasks, _numThreads);
+
+		size_t total = 0;
+		for (auto& res : shardResults) total += res.size();
+		_results.reserve(total);
+		for (auto& res : shardResults) {
+			std::move(res.begin(), res.end(), std::back_inserter(_results));
+		}
+
+		_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		ofLogNotice("BatchProcessor") << _results.size() << " frames from " << _recordings.size() << " recordings ("
+			<< shards.size() << " shards) in " << _elapsed << " s: " << getFramesPerSecond() << " frames/s";
+
+		return ok;
+	}
+
+	bool BatchProcessor::findStartTimes(int recording, vector<Shard*>& shards) {
+
+		auto reader = _recordings[recording]();
+		if (!reader) {
+			ofLogError("BatchProcessor::findStartTimes") << "couldn't open recording " << recording;
+			return false;
+		}
+
+		// same rule as User::setBody(): a slot's user starts when its body becomes tracked
+		vector<float> runStart; // per slot, < 0 while untracked
+		RecordedFrame frame;
+		size_t next = 0;
+		for (size_t f = 0; next < shards.size(); f++) {
+
+			if (!reader->readFrame(f, frame)) {
+				ofLogError("BatchProcessor::findStartTimes") << "couldn't read frame " << f << " of recording " << recording;
+				return false;
+			}
+			if (runStart.size() < frame.bodies.size()) runStart.resize(frame.bodies.size(), -1);
+
+			// shards starting here see tracks that began before this frame
+			for (; next < shards.size() && shards[next]->first == f; next++) {
+				vector<float>& startTimes = shards[next]->startTimes;
+				startTimes.assign(runStart.size(), -1);
+				for (size_t k = 0; k < runStart.size(); k++) {
+					if (k < frame.bodies.size() && frame.bodies[k].tracked) startTimes[k] = runStart[k];
+				}
+			}
+
+			for (size_t k = 0; k < runStart.size(); k++) {
+				bool tracked = k < frame.bodies.size() && frame.bodies[k].tracked;
+				if (!tracked) runStart[k] = -1;
+				else if (runStart[k] < 0) runStart[k] = (float)frame.time;
+			}
+		}
+		return true;
+	}
+
+	bool BatchProcessor::processShard(const Shard& shard, vector<FrameResult>& out) {
+
+		auto reader = _recordings[shard.recording]();
+		if (!reader) {
+			ofLogError("BatchProcessor::processShard") << "couldn't open recording " << shard.recording;
+			return false;
+		}
+
+		// one user per body slot, like a live app
+		vector<User> users(6);
+		vector<User*> userPtrs;
+		for (auto& user : users) {
+			user.setProject2d(false); // no sensor, no coordinate mapper
+			if (_userSetup) _userSetup(user);
+			userPtrs.push_back(&user);
+		}
+
+		RecordedFrame frame;
+		const size_t first = shard.first;
+		out.reserve(shard.end - shard.begin);
+
+		for (size_t f = first; f < shard.end; f++) {
+
+			if (!reader->readFrame(f, frame)) {
+				ofLogError("BatchProcessor::processShard") << "couldn't read frame " << f << " of recording " << shard.recording;
+				return false;
+			}
+
+			for (size_t k = 0; k < users.size(); k++) {
+				kBody* body = (k < frame.bodies.size() && frame.bodies[k].tracked) ? &frame.bodies[k] : nullptr;
+				users[k].setClockTime(frame.time);
+				users[k].setBody(body);
+
+				// tracked since before this shard: not new, same start time as a live run
+				if (f == first && body && k < shard.startTimes.size() && shard.startTimes[k] >= 0) {
+					User::State state = users[k].getState();
+					state.startTime = shard.startTimes[k];
+					users[k].restoreState(state);
+				}
+			}
+			User::update(userPtrs, _lerp, _inferLerp);
+			if (f < shard.begin) continue; // warming up
+
+			core::Floor floor(toCore(frame.floorClipPlane)); // transform & inverse once for all users
+
+			out.push_back(FrameResult());
+			FrameResult& result = out.back();
+			result.recording = shard.recording;
+			result.frame = f;
+			result.time = frame.time;
+
+			for (auto& user : users) {
+				if (!user.hasBody()) continue;
+				kBody* body = user.getBodyPtr();
+
+				UserResult u;
+				u.bodyId = body->bodyId;
+				u.trackingId = body->trackingId;
+				u.userTime = user.getUserTime();
+				u.isNew = user.isNew();
+				u.spineBase = user.getJoint3dPos(JointType_SpineBase);
+
+				// same math as Kinect::getBodiesWithinBounds(), bit for bit
+				auto spine = body->joints.find(JointType_SpineBase);
+				if (spine != body->joints.end() && spine->second.getTrackingState() != TrackingState_NotTracked) {
+					core::Vec3 floorPos = floor.closestPtOnPlane(toCore(spine->second.getPosition()));
+					u.floorPos = ofVec2f(floorPos.x, floorPos.z);
+					u.inBounds = _floorBounds.inside(u.floorPos);
+				}
+				result.users.push_back(u);
+			}
+
+			if (_frameCallback) _frameCallback(frame, users, result);
+		}
+
+		return true;
+	}
+
+	bool BatchProcessor::writeCsv(const string& path) const {
+
+		std::ofstream file(ofToDataPath(path));
+		if (!file) {
+			ofLogError("BatchProcessor::writeCsv") << "couldn't open " << path;
+			return false;
+		}
+
+		file << "recording,frame,time,bodyId,trackingId,userTime,isNew,spineX,spineY,spineZ,floorX,floorZ,inBounds\n";
+		for (auto& res : _results) {
+			for (auto& u : res.users) {
+				file << res.recording << ',' << res.frame << ',' << res.time << ','
+					<< u.bodyId << ',' << u.trackingId << ',' << u.userTime << ',' << u.isNew << ','
+					<< u.spineBase.x << ',' << u.spineBase.y << ',' << u.spineBase.z << ','
+					<< u.floorPos.x << ',' << u.floorPos.y << ',' << u.inBounds << '\n';
+			}
+		}
+		return true;
+	}
+
+}
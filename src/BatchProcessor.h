@@ -0,0 +1,92 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "Kinect.h"
+#include "User.h"
+#include "Recording.h"
+
+namespace ofxKinectForWindows2 {
+
+	// headless reprocessing of recorded sessions, faster than real time
+	// recordings are cut into shards (frame ranges) and run on a work-stealing thread pool,
+	// every shard replays its own User pipeline (User::update(), floor position, floor bounds)
+	// shards start warmupFrames early so lerping settles before results are kept,
+	// users tracked into a shard get their start time from a sequential pre-pass over the body slots,
+	// so getUserTime() / isNew() are the same as in a live run, whatever the shard length
+	// results are merged in recording / frame order, independent of thread count and scheduling
+	// buildMesh() needs live depth + the sensor's coordinate mapper and is not part of the batch
+
+	class BatchProcessor {
+	public:
+
+		typedef std::function<std::unique_ptr<FrameReader>()> ReaderFactory;
+
+		struct UserResult {
+			int bodyId = -1;
+			UINT64 trackingId = 0;
+			float userTime = 0;			// User::getUserTime() on the recording's clock
+			bool isNew = false;			// User::isNew()
+			ofVec3f spineBase;			// joint pos3d, transformed by the user node
+			ofVec2f floorPos;			// x,z on the floor plane
+			bool inBounds = false;		// floorPos inside floor bounds
+		};
+
+		struct FrameResult {
+			int recording = 0;
+			size_t frame = 0;
+			double time = 0;
+			vector<UserResult> users;
+		};
+
+		// extra per frame work on the worker thread, users are indexed by body slot
+		typedef std::function<void(const RecordedFrame& frame, vector<User>& users, FrameResult& result)> FrameCallback;
+		// applied to every worker's users before processing (world scale, mirroring, ...)
+		typedef std::function<void(User& user)> UserSetup;
+
+		int addRecording(ReaderFactory factory); // returns recording index
+		void clearRecordings()						{ _recordings.clear(); }
+
+		void setNumThreads(int n)					{ _numThreads = std::max(1, n); }
+		void setShardLength(size_t frames)			{ _shardLength = frames; }	// 0 = whole recordings
+		void setWarmupFrames(size_t frames)			{ _warmupFrames = frames; }
+		void setFloorBounds(ofRectangle bounds)		{ _floorBounds = bounds; }	// x,z
+		void setLerp(float lerp, float inferLerp)	{ _lerp = lerp; _inferLerp = inferLerp; }
+		void setUserSetup(UserSetup setup)			{ _userSetup = setup; }
+		void setFrameCallback(FrameCallback cb)		{ _frameCallback = cb; }
+
+		bool run(); // blocks until all recordings are processed
+
+		const vector<FrameResult>& getResults() const	{ return _results; }
+		bool writeCsv(const string& path) const;
+
+		size_t getNumFramesProcessed() const	{ return _results.size(); }
+		double getElapsedSeconds() const		{ return _elapsed; }
+		double getFramesPerSecond() const		{ return _elapsed > 0 ? _results.size() / _elapsed : 0; }
+
+	protected:
+
+		struct Shard {
+			int recording;
+			size_t begin, end;			// frames kept
+			size_t first;				// first frame read, begin - warm up
+			vector<float> startTimes;	// per body slot: start time of a track running into first, < 0 if none
+		};
+
+		bool findStartTimes(int recording, vector<Shard*>& shards); // fills startTimes, shards in frame order
+		bool processShard(const Shard& shard, vector<FrameResult>& out);
+
+		vector<ReaderFactory> _recordings;
+
+		int _numThreads = 1;
+		size_t _shardLength = 30 * 60 * 5; // 5 min @ 30 fps
+		size_t _warmupFrames = 30;
+		ofRectangle _floorBounds = ofRectangle(-2, 0, 4, 5);
+		float _lerp = 1., _inferLerp = 1.;
+		UserSetup _userSetup;
+		FrameCallback _frameCallback;
+
+		vector<FrameResult> _results;
+		double _elapsed = 0;
+	};
+
+}
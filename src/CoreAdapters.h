@@ -0,0 +1,32 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "core/Math3d.h"
+#include "core/Clock.h"
+
+namespace ofxKinectForWindows2 {
+
+	// OF <-> core conversions, the core types share OF's layout & conventions so these are plain copies
+	// (vertex & tex coord buffers are reinterpreted in place, see User::buildMesh())
+
+	static_assert(sizeof(ofVec2f) == sizeof(core::Vec2), "ofVec2f & core::Vec2 layouts differ");
+	static_assert(sizeof(ofVec3f) == sizeof(core::Vec3), "ofVec3f & core::Vec3 layouts differ");
+	static_assert(sizeof(ofIndexType) == sizeof(uint32_t), "mesh indices aren't 32 bit");
+
+	inline core::Vec2 toCore(const ofVec2f& v)			{ return core::Vec2(v.x, v.y); }
+	inline core::Vec3 toCore(const ofVec3f& v)			{ return core::Vec3(v.x, v.y, v.z); }
+	inline core::Vec4 toCore(const ofVec4f& v)			{ return core::Vec4(v.x, v.y, v.z, v.w); }
+	inline core::Vec4 toCore(const Vector4& v)			{ return core::Vec4(v.x, v.y, v.z, v.w); }
+	inline core::Quat toCore(const ofQuaternion& q)		{ return core::Quat(q.x(), q.y(), q.z(), q.w()); }
+	inline core::Mat4 toCore(const ofMatrix4x4& m)		{ return core::Mat4(m.getPtr()); }
+
+	inline ofVec2f toOf(const core::Vec2& v)			{ return ofVec2f(v.x, v.y); }
+	inline ofVec3f toOf(const core::Vec3& v)			{ return ofVec3f(v.x, v.y, v.z); }
+	inline ofVec4f toOf(const core::Vec4& v)			{ return ofVec4f(v.x, v.y, v.z, v.w); }
+	inline ofQuaternion toOf(const core::Quat& q)		{ return ofQuaternion(q.x, q.y, q.z, q.w); }
+	inline ofMatrix4x4 toOf(const core::Mat4& m)		{ return ofMatrix4x4(m.getPtr()); }
+
+	// core::Clock source for apps
+	inline double ofElapsedSeconds() { return ofGetElapsedTimef(); }
+
+}
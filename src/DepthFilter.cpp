@@ -0,0 +1,260 @@
+#include "DepthFilter.h"
+#include "Parallel.h"
+#include "core/Simd.h"
+
+namespace ofxKinectForWindows2 {
+
+	namespace {
+
+		// masked value of background px & body px without depth, sorts above any depth
+		const UINT16 kNoDepth = 0x7FFF;
+
+		// median of the samples with depth (lower median for an even count), 0 if none
+		UINT16 medianOfValid(const UINT16* s) {
+			UINT16 v[9];
+			int n = 0;
+			for (int k = 0; k < 9; k++) {
+				if (s[k] != kNoDepth) v[n++] = s[k];
+			}
+			if (!n) return 0;
+			std::nth_element(v, v + (n - 1) / 2, v + n);
+			return v[(n - 1) / 2];
+		}
+
+#ifdef OFXKINECT2USER_SSE2
+		// unsigned 16 bit min without SSE4.1
+		inline __m128i minU16(__m128i a, __m128i b) {
+			return _mm_sub_epi16(a, _mm_subs_epu16(a, b));
+		}
+
+		// 8 lanes of background px (body index 255) as 16 bit masks
+		inline __m128i backgroundMask(const unsigned char* bodyIdx) {
+			__m128i bg = _mm_cmpeq_epi8(_mm_loadl_epi64((const __m128i*)bodyIdx), _mm_set1_epi8((char)0xFF));
+			return _mm_unpacklo_epi8(bg, bg);
+		}
+
+		// same as medianOfValid() on 8 lanes: kNoDepth samples sort to the top (depth < 32768, signed compares are fine),
+		// the median is picked from the 5 lowest by each lane's count of valid samples
+		inline __m128i medianOfValid(__m128i p0, __m128i p1, __m128i p2, __m128i p3, __m128i p4,
+									 __m128i p5, __m128i p6, __m128i p7, __m128i p8) {
+
+			const __m128i none = _mm_set1_epi16((short)kNoDepth);
+			__m128i invalid = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(_mm_cmpeq_epi16(p0, none), _mm_cmpeq_epi16(p1, none)),
+														  _mm_add_epi16(_mm_cmpeq_epi16(p2, none), _mm_cmpeq_epi16(p3, none))),
+											_mm_add_epi16(_mm_add_epi16(_mm_cmpeq_epi16(p4, none), _mm_cmpeq_epi16(p5, none)),
+														  _mm_add_epi16(_mm_add_epi16(_mm_cmpeq_epi16(p6, none), _mm_cmpeq_epi16(p7, none)),
+																		_mm_cmpeq_epi16(p8, none))));
+			invalid = _mm_sub_epi16(_mm_setzero_si128(), invalid); // masks are -1
+
+			// sorting network, 9 inputs, trimmed to what p0-p4 depend on
+#define SORT2(a, b) { __m128i t = _mm_min_epi16(a, b); b = _mm_max_epi16(a, b); a = t; }
+			SORT2(p0, p3); SORT2(p1, p7); SORT2(p2, p5); SORT2(p4, p8);
+			SORT2(p0, p7); SORT2(p2, p4); SORT2(p3, p8); SORT2(p5, p6);
+			SORT2(p0, p2); SORT2(p1, p3); SORT2(p4, p5); SORT2(p7, p8);
+			SORT2(p1, p4); SORT2(p3, p6); SORT2(p5, p7);
+			SORT2(p0, p1); SORT2(p2, p4); SORT2(p3, p5);
+			SORT2(p2, p3); SORT2(p4, p5);
+			SORT2(p1, p2); SORT2(p3, p4);
+#undef SORT2
+
+			// valid count 1-2 -> p0, 3-4 -> p1, 5-6 -> p2, 7-8 -> p3, 9 -> p4 (none -> p0 = kNoDepth)
+			__m128i med = p0;
+			__m128i sel;
+			sel = _mm_cmplt_epi16(invalid, _mm_set1_epi16(7)); med = _mm_or_si128(_mm_andnot_si128(sel, med), _mm_and_si128(sel, p1));
+			sel = _mm_cmplt_epi16(invalid, _mm_set1_epi16(5)); med = _mm_or_si128(_mm_andnot_si128(sel, med), _mm_and_si128(sel, p2));
+			sel = _mm_cmplt_epi16(invalid, _mm_set1_epi16(3)); med = _mm_or_si128(_mm_andnot_si128(sel, med), _mm_and_si128(sel, p3));
+			sel = _mm_cmplt_epi16(invalid, _mm_set1_epi16(1)); med = _mm_or_si128(_mm_andnot_si128(sel, med), _mm_and_si128(sel, p4));
+			return _mm_andnot_si128(_mm_cmpeq_epi16(med, none), med);
+		}
+#endif
+
+		// masked row back to depth, kNoDepth -> 0
+		void unmaskRow(const UINT16* masked, UINT16* out, int n) {
+			for (int i = 0; i < n; i++) out[i] = masked[i] == kNoDepth ? 0 : masked[i];
+		}
+	}
+
+	DepthFilter::DepthFilter() {
+		_last.resize(512 * 424);
+		_masked.resize(512 * 424);
+		_spatial.resize(512 * 424);
+		setHistoryLength(4);
+	}
+
+	void DepthFilter::setHistoryLength(int frames) {
+		_ringLength = ofClamp(frames, 1, 8);
+		_ring.assign(_ringLength, vector<UINT16>(512 * 424));
+		reset();
+	}
+
+	void DepthFilter::reset() {
+		_ringHead = 0;
+		_ringCount = 0;
+		std::fill(_last.begin(), _last.end(), 0);
+		_pixels.clear(); // next update() filters whatever it gets, even a frame equal to _last
+	}
+
+	bool DepthFilter::update(const ofShortPixels& depthPix, const ofPixels& bodyIdxPix) {
+
+		if (depthPix.size() != 512 * 424 || bodyIdxPix.size() != 512 * 424) {
+			ofLogError("DepthFilter::update") << "can't filter, depth / body index frames not allocated";
+			return false;
+		}
+
+		const UINT16* depth = (const UINT16*)depthPix.getPixels();
+		const unsigned char* bodyIdx = bodyIdxPix.getPixels();
+
+		// update() can run more often than the sensor delivers frames, don't feed repeats into the history
+		if (_pixels.size() && memcmp(depth, _last.data(), 512 * 424 * sizeof(UINT16)) == 0) return true;
+		memcpy(_last.data(), depth, 512 * 424 * sizeof(UINT16));
+		if (!_pixels.size()) _pixels.allocate(512, 424, 1);
+
+		parallelFor(0, 424, _numThreads, [&](int y0, int y1, int) {
+			maskRows(y0, y1, depth, bodyIdx);
+		});
+		parallelFor(0, 424, _numThreads, [&](int y0, int y1, int) {
+			filterRows(y0, y1, depth, bodyIdx);
+		});
+
+		if (_bTemporal) {
+			_ringHead = (_ringHead + 1) % _ringLength;
+			_ringCount = std::min(_ringCount + 1, _ringLength);
+		}
+		return true;
+	}
+
+	void DepthFilter::maskRows(int y0, int y1, const UINT16* depth, const unsigned char* bodyIdx) {
+
+		UINT16* masked = _masked.data();
+		int i = y0 * 512;
+		const int end = y1 * 512;
+#ifdef OFXKINECT2USER_SSE2
+		const __m128i maxDepth = _mm_set1_epi16(kNoDepth - 1);
+		const __m128i none = _mm_set1_epi16((short)kNoDepth);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= end; i += 8) {
+			__m128i raw = _mm_loadu_si128((const __m128i*)(depth + i));
+			__m128i invalid = _mm_or_si128(backgroundMask(bodyIdx + i), _mm_cmpeq_epi16(raw, zero));
+			__m128i d = minU16(raw, maxDepth);
+			_mm_storeu_si128((__m128i*)(masked + i), _mm_or_si128(_mm_andnot_si128(invalid, d), _mm_and_si128(invalid, none)));
+		}
+#endif
+		for (; i < end; i++) {
+			masked[i] = (bodyIdx[i] == 255 || !depth[i]) ? kNoDepth : std::min<UINT16>(depth[i], kNoDepth - 1);
+		}
+	}
+
+	void DepthFilter::filterRows(int y0, int y1, const UINT16* depth, const unsigned char* bodyIdx) {
+
+		const UINT16* masked = _masked.data();
+		UINT16* spatial = _spatial.data();
+		UINT16* out = _pixels.getPixels();
+
+		for (int y = y0; y < y1; y++) {
+
+			const int row = y * 512;
+
+			// spatial
+
+			if (!_bSpatial || y == 0 || y == 423) {
+				unmaskRow(masked + row, spatial + row, 512);
+			}
+			else {
+				unmaskRow(masked + row, spatial + row, 1);
+				unmaskRow(masked + row + 511, spatial + row + 511, 1);
+
+				int x = 1;
+#ifdef OFXKINECT2USER_SSE2
+				for (; x + 8 <= 511; x += 8) {
+					const UINT16* t = masked + row - 512 + x;
+					const UINT16* m = masked + row + x;
+					const UINT16* b = masked + row + 512 + x;
+					__m128i med = medianOfValid(
+						_mm_loadu_si128((const __m128i*)(t - 1)), _mm_loadu_si128((const __m128i*)t), _mm_loadu_si128((const __m128i*)(t + 1)),
+						_mm_loadu_si128((const __m128i*)(m - 1)), _mm_loadu_si128((const __m128i*)m), _mm_loadu_si128((const __m128i*)(m + 1)),
+						_mm_loadu_si128((const __m128i*)(b - 1)), _mm_loadu_si128((const __m128i*)b), _mm_loadu_si128((const __m128i*)(b + 1)));
+					_mm_storeu_si128((__m128i*)(spatial + row + x), _mm_andnot_si128(backgroundMask(bodyIdx + row + x), med));
+				}
+#endif
+				for (; x < 511; x++) {
+					int i = row + x;
+					if (bodyIdx[i] == 255) {
+						spatial[i] = 0;
+						continue;
+					}
+					UINT16 v[9] = {
+						masked[i - 513], masked[i - 512], masked[i - 511],
+						masked[i - 1], masked[i], masked[i + 1],
+						masked[i + 511], masked[i + 512], masked[i + 513] };
+					spatial[i] = medianOfValid(v);
+				}
+			}
+
+			// temporal
+
+			const int nHist = _bTemporal ? _ringCount : 0;
+			int x = 0;
+#ifdef OFXKINECT2USER_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i one = _mm_set1_epi16(1);
+			const __m128i thr = _mm_set1_epi16((short)_threshold);
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 oneF = _mm_set1_ps(1.f);
+			for (; x + 8 <= 512; x += 8) {
+				const int i = row + x;
+				__m128i bg = backgroundMask(bodyIdx + i);
+				__m128i cur = _mm_loadu_si128((const __m128i*)(spatial + i));
+				__m128i res = cur;
+
+				if (nHist) {
+					__m128i curZero = _mm_cmpeq_epi16(cur, zero);
+					__m128i sumLo = _mm_unpacklo_epi16(cur, zero);
+					__m128i sumHi = _mm_unpackhi_epi16(cur, zero);
+					__m128i cnt = _mm_andnot_si128(curZero, one);
+
+					for (int k = 0; k < nHist; k++) {
+						__m128i h = _mm_loadu_si128((const __m128i*)(_ring[k].data() + i));
+						__m128i diff = _mm_or_si128(_mm_subs_epu16(h, cur), _mm_subs_epu16(cur, h));
+						__m128i near = _mm_cmpeq_epi16(_mm_subs_epu16(diff, thr), zero);
+						__m128i valid = _mm_andnot_si128(_mm_cmpeq_epi16(h, zero), _mm_or_si128(near, curZero));
+						h = _mm_and_si128(h, valid);
+						sumLo = _mm_add_epi32(sumLo, _mm_unpacklo_epi16(h, zero));
+						sumHi = _mm_add_epi32(sumHi, _mm_unpackhi_epi16(h, zero));
+						cnt = _mm_add_epi16(cnt, _mm_and_si128(valid, one));
+					}
+
+					__m128 nLo = _mm_max_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(cnt, zero)), oneF);
+					__m128 nHi = _mm_max_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(cnt, zero)), oneF);
+					__m128i lo = _mm_cvttps_epi32(_mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(sumLo), nLo), half));
+					__m128i hi = _mm_cvttps_epi32(_mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(sumHi), nHi), half));
+					res = _mm_packs_epi32(lo, hi);
+				}
+
+				// background keeps raw depth
+				__m128i raw = _mm_loadu_si128((const __m128i*)(depth + i));
+				_mm_storeu_si128((__m128i*)(out + i), _mm_or_si128(_mm_andnot_si128(bg, res), _mm_and_si128(bg, raw)));
+			}
+#endif
+			for (; x < 512; x++) {
+				const int i = row + x;
+				if (bodyIdx[i] == 255) {
+					out[i] = depth[i];
+					continue;
+				}
+				const UINT16 cur = spatial[i];
+				int sum = cur, n = cur ? 1 : 0;
+				for (int k = 0; k < nHist; k++) {
+					UINT16 h = _ring[k][i];
+					if (h && (!cur || abs((int)h - (int)cur) <= _threshold)) {
+						sum += h;
+						n++;
+					}
+				}
+				out[i] = n ? (UINT16)(sum / (float)n + 0.5f) : 0;
+			}
+
+			if (_bTemporal) memcpy(_ring[_ringHead].data() + row, spatial + row, 512 * sizeof(UINT16));
+		}
+	}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+
+namespace ofxKinectForWindows2 {
+
+	// depth preprocessing for body px, run once per frame before meshing / mapping
+	// spatial: 3x3 median over the body px with depth only, background & depth holes aren't samples
+	//          (no pull towards 0 or the nearest depth at the silhouette), so holes with any such
+	//          neighbour are filled by the median
+	// temporal: average with the last few spatially filtered frames kept in a fixed ring,
+	//           samples further than the threshold from the current depth are rejected (motion)
+	// non-body px pass through untouched
+	// assumes depth < 32768 mm (kinect v2 reports up to ~8000)
+
+	class DepthFilter {
+	public:
+
+		DepthFilter();
+
+		void setSpatial(bool spatial)				{ _bSpatial = spatial; }
+		void setTemporal(bool temporal)				{ _bTemporal = temporal; }
+		void setHistoryLength(int frames);			// 1 - 8, default 4
+		void setTemporalThreshold(int mm)			{ _threshold = ofClamp(mm, 0, 32767); }
+		void setNumThreads(int n)					{ _numThreads = std::max(1, n); }
+		void reset();								// drops temporal history & the last filtered frame
+
+		bool update(const ofShortPixels& depthPix, const ofPixels& bodyIdxPix); // skips frames it has already seen
+		const ofShortPixels& getPixels() const		{ return _pixels; }
+		bool isAllocated() const					{ return _pixels.size() > 0; } // false until the first frame
+
+	protected:
+
+		void maskRows(int y0, int y1, const UINT16* depth, const unsigned char* bodyIdx);
+		void filterRows(int y0, int y1, const UINT16* depth, const unsigned char* bodyIdx);
+
+		bool _bSpatial = true;
+		bool _bTemporal = true;
+		int _threshold = 30;
+		int _numThreads = 1;
+
+		vector<UINT16> _last;		// last raw frame, to skip repeated updates
+		vector<UINT16> _masked;		// body px depth, 0x7FFF for background & no depth
+		vector<UINT16> _spatial;	// spatially filtered body px
+		vector<vector<UINT16>> _ring; // spatial history, fixed size
+		int _ringLength = 4;
+		int _ringHead = 0;			// next slot to overwrite
+		int _ringCount = 0;			// filled slots
+
+		ofShortPixels _pixels;
+	};
+
+}
@@ -20,6 +20,73 @@ namespace ofxKinectForWindows2 {
 		setUseTextures(true); // not sure if necessary
 	}
 
+	void Kinect::setDepthFiltering(bool filter) {
+		if (filter && !_bFilterDepth) _depthFilter.reset();
+		_bFilterDepth = filter;
+	}
+
+	const ofShortPixels& Kinect::getDepthPixels() {
+
+		auto& depthPix = getDepthSource()->getPixels();
+		if (!_bFilterDepth || !getBodyIndexSource()) return depthPix;
+
+		// DepthFilter::update() skips frames it has already filtered, so this is cheap after the first call
+		auto& bodyIdxPix = getBodyIndexSource()->getPixels();
+		if (depthPix.size() != 512 * 424 || bodyIdxPix.size() != 512 * 424) return depthPix;
+		if (!_depthFilter.update(depthPix, bodyIdxPix)) return depthPix;
+		return _depthFilter.getPixels();
+	}
+
+	bool Kinect::isSameDepth(vector<UINT16>& key, const ofShortPixels& depthPix) {
+
+		const UINT16* depth = (const UINT16*)depthPix.getPixels();
+		if (key.size() == depthPix.size() && memcmp(depth, key.data(), key.size() * sizeof(UINT16)) == 0) return true;
+		key.assign(depth, depth + depthPix.size());
+		return false;
+	}
+
+	const vector<ofVec2f>& Kinect::getDepthToColorCoords() {
+
+		if (!_coordinateMapper || !getDepthSource() || getDepthPixels().size() != 512 * 424) {
+			_depthToColorKey.clear();
+			_depthToColorCoords.clear();
+			return _depthToColorCoords;
+		}
+		auto& depthPix = getDepthPixels();
+		if (isSameDepth(_depthToColorKey, depthPix)) return _depthToColorCoords;
+
+		_depthToColorCoords.resize(512 * 424);
+		if (FAILED(_coordinateMapper->MapDepthFrameToColorSpace(512 * 424, (UINT16*)depthPix.getPixels(),
+																512 * 424, (ColorSpacePoint*)_depthToColorCoords.data()))) {
+			ofLogWarning("Kinect::getDepthToColorCoords") << "can't map depth frame to color space";
+			_depthToColorKey.clear();
+			_depthToColorCoords.clear();
+			return _depthToColorCoords;
+		}
+		return _depthToColorCoords;
+	}
+
+	const vector<DepthSpacePoint>& Kinect::getColorToDepthCoords() {
+
+		if (!_coordinateMapper || !getDepthSource() || getDepthPixels().size() != 512 * 424) {
+			_colorToDepthKey.clear();
+			_colorToDepthCoords.clear();
+			return _colorToDepthCoords;
+		}
+		auto& depthPix = getDepthPixels();
+		if (isSameDepth(_colorToDepthKey, depthPix)) return _colorToDepthCoords;
+
+		_colorToDepthCoords.resize(1920 * 1080);
+		if (FAILED(_coordinateMapper->MapColorFrameToDepthSpace(512 * 424, (UINT16*)depthPix.getPixels(),
+																1920 * 1080, _colorToDepthCoords.data()))) {
+			ofLogWarning("Kinect::getColorToDepthCoords") << "can't map color frame to depth space";
+			_colorToDepthKey.clear();
+			_colorToDepthCoords.clear();
+			return _colorToDepthCoords;
+		}
+		return _colorToDepthCoords;
+	}
+
 	kBody* Kinect::getBodyPtrByIndex(int bodyIndex) {
 
 		auto& bodies = getBodySource()->getBodies();
@@ -48,42 +115,33 @@ namespace ofxKinectForWindows2 {
 
 	ofMatrix4x4 Kinect::getFloorTransform()
 	{
-		auto fcp = getFloorClipPlane();
-		ofVec3f normal(fcp.x, fcp.y, fcp.z);
-		float distance = fcp.w;
-
-		ofMatrix4x4 rot, trans;
-
-		// check for floor clip plane data
-		if (normal != ofVec3f(0) || distance != 0) {
-			rot.makeRotationMatrix(ofVec3f(0, 1, 0), ofVec3f(normal)); // rotation of plane
-			trans.makeTranslationMatrix(normal*-distance); // origin of plane
-		}
+		return floorTransform = floorTransformFromPlane(getFloorClipPlane());
+	}
 
-		return floorTransform = rot*trans;
+	ofMatrix4x4 Kinect::floorTransformFromPlane(Vector4 fcp)
+	{
+		return toOf(core::Floor::transformFromPlane(toCore(fcp)));
 	}
 
 	ofVec3f Kinect::getClosestPtOnFloor(ofVec3f pos)
 	{
-		ofMatrix4x4 floor = getFloorTransform();
-		ofVec3f o =			floor.getTranslation();	// floor origin
-		ofVec3f n =			ofVec3f(0, 1, 0) * floor.getRotate();	// floor normal
-
-		float floorDist = 
-			ofVec3f(o.x - pos.x, o.y - pos.y, o.z - pos.z).dot(n);
-			// distance to floor = dot(orig-pt, normal)
+		return closestPtOnFloor(getFloorTransform(), pos);
+	}
 
-		return pos + n*floorDist;
+	ofVec3f Kinect::closestPtOnFloor(const ofMatrix4x4& floor, ofVec3f pos)
+	{
+		return toOf(core::Floor::closestPt(toCore(floor), toCore(pos)));
 	}
 
 	ofVec3f Kinect::getClosestPtOnFloorPlane(ofVec3f pos)
 	{
-		return getClosestPtOnFloor(pos) * getFloorTransform().getInverse();
+		core::Floor floor(toCore(getFloorClipPlane()));
+		return toOf(floor.closestPtOnPlane(toCore(pos)));
 	}
 
 	ofVec2f Kinect::getClosestPtOnFloorPlaneXY(ofVec3f pos)
 	{
-		ofVec3f pt = getClosestPtOnFloor(pos) * getFloorTransform().getInverse();
+		ofVec3f pt = getClosestPtOnFloorPlane(pos);
 		return ofVec2f(pt.x,pt.z);
 	}
 
@@ -106,6 +164,7 @@ namespace ofxKinectForWindows2 {
 
 		auto bodies = getTrackedBodies();
 		map<float, kBody*> bodiesInByDist;
+		core::Floor floor(toCore(getFloorClipPlane())); // transform & inverse once for all bodies
 
 		for (auto body : bodies) {
 
@@ -114,7 +173,7 @@ namespace ofxKinectForWindows2 {
 			auto& spine = body->joints.at(JointType_SpineBase);
 			if (spine.getTrackingState() == TrackingState_NotTracked) continue;
 
-			ofVec3f floorPos = getClosestPtOnFloorPlane(spine.getPosition()); // x,z
+			core::Vec3 floorPos = floor.closestPtOnPlane(toCore(spine.getPosition())); // x,z
 			ofVec2f floorXY(floorPos.x, floorPos.z);
 
 			if (floorBounds.inside(floorXY)) {
@@ -1,6 +1,9 @@
 #pragma once
 #include "ofMain.h"
 #include "ofxKinectForWindows2.h"
+#include "DepthFilter.h"
+#include "CoreAdapters.h"
+#include "core/Floor.h"
 
 namespace ofxKinectForWindows2 {
 
@@ -17,10 +20,19 @@ namespace ofxKinectForWindows2 {
 		void init(bool bColor = true, bool bBody = true,
 				  bool bDepth = false, bool bBodyIdx = false, bool bIR = false, bool bIRLong = false);
 
+		// optional depth preprocessing (needs depth & body index sources)
+		// the current depth frame is filtered on first use, whichever update() the app calls
+		void setDepthFiltering(bool filter);	// turning it on drops the old temporal history
+		bool getDepthFiltering() const		{ return _bFilterDepth; }
+		DepthFilter& getDepthFilter()		{ return _depthFilter; }
+		const ofShortPixels& getDepthPixels(); // filtered if depth filtering is on, raw if this frame can't be filtered
+
 		Vector4 getFloorClipPlane()			{ return getBodySource()->getFloorClipPlane(); }
 		ofVec4f getFloorClipPlaneOfVec4f()	{ Vector4 f = getFloorClipPlane(); 
 											  return ofVec4f(f.x, f.y, f.z, f.w); }
 		ofMatrix4x4 getFloorTransform();
+		static ofMatrix4x4 floorTransformFromPlane(Vector4 floorClipPlane); // same math without a sensor, e.g. recorded planes
+		static ofVec3f closestPtOnFloor(const ofMatrix4x4& floorTransform, ofVec3f pos);
 		ofVec3f getFloorOrigin()			{ return getFloorTransform().getTranslation(); }
 		ofQuaternion getFloorOrientation()	{ return getFloorTransform().getRotate(); }
 		ofVec3f getClosestPtOnFloor(ofVec3f pos);
@@ -41,6 +53,11 @@ namespace ofxKinectForWindows2 {
 		int getNumTrackedBodies();
 
 		ICoordinateMapper* getCoordinateMapper() { return _coordinateMapper; }
+		// coords of the current depth frame (getDepthPixels()), mapped on first use & shared by all users
+		// keyed on the depth values, not on update() calls, so any update path & filter toggle remaps
+		// empty if there's no mapper / depth yet
+		const vector<ofVec2f>& getDepthToColorCoords();				// 512x424, -inf where there's no depth
+		const vector<DepthSpacePoint>& getColorToDepthCoords();		// 1920x1080, -inf where there's no depth
 		bool hasColorStream() { return getColorPixels().size() > 0; }
 		ofPixels& getColorPixels() { return getColorSource()->getPixels(); }
 		ofTexture& getColorTexture() { return getColorSource()->getTexture(); }
@@ -64,6 +81,15 @@ namespace ofxKinectForWindows2 {
 		ofFbo _flipFbo;
 
 		ofMatrix4x4 floorTransform;
+
+		DepthFilter _depthFilter;
+		bool _bFilterDepth = false;
+
+		static bool isSameDepth(vector<UINT16>& key, const ofShortPixels& depthPix); // & stores depthPix as the new key
+		vector<UINT16> _depthToColorKey;	// depth the coords were mapped from, empty if not mapped
+		vector<UINT16> _colorToDepthKey;
+		vector<ofVec2f> _depthToColorCoords;
+		vector<DepthSpacePoint> _colorToDepthCoords;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "OccupancyMap.h"
+#include "Parallel.h"
+#include "core/Simd.h"
+
+namespace ofxKinectForWindows2 {
+
+	namespace {
+		const float kDepthFocalPx = 365.5f; // approx. kinect v2 depth camera focal length, pixels
+
+		inline bool isBodyPx(unsigned char val, int bodyId) {
+			return bodyId < 0 ? val != 255 : val == bodyId;
+		}
+	}
+
+	void OccupancyMap::setup(ofRectangle floorBounds, float cellSize) {
+
+		if (cellSize <= 0) {
+			ofLogError("OccupancyMap::setup") << "invalid cell size: " << cellSize;
+			return;
+		}
+
+		_floorBounds = floorBounds;
+		_cellSize = cellSize;
+		_cols = std::max(1, (int)ceilf(floorBounds.width / cellSize));
+		_rows = std::max(1, (int)ceilf(floorBounds.height / cellSize));
+
+		_occupancy.assign(_cols * _rows, 0);
+		_dwell.assign(_cols * _rows, 0);
+		_coverage.assign(_cols * _rows, 0);
+		_threadCoverage.clear();
+		_cameraPts.resize(512 * 424); // depth size
+	}
+
+	void OccupancyMap::reset() {
+		std::fill(_occupancy.begin(), _occupancy.end(), 0);
+		std::fill(_dwell.begin(), _dwell.end(), 0);
+		std::fill(_coverage.begin(), _coverage.end(), 0);
+	}
+
+	bool OccupancyMap::update(Kinect* kinect, float dt) {
+
+		if (!_cols || !_rows) {
+			ofLogError("OccupancyMap::update") << "can't update, call setup() first";
+			return false;
+		}
+		if (kinect == nullptr) {
+			ofLogError("OccupancyMap::update") << "can't update, kinect is null";
+			return false;
+		}
+		ICoordinateMapper* mapper = kinect->getCoordinateMapper();
+		if (mapper == nullptr) {
+			ofLogError("OccupancyMap::update") << "can't update, no coordinate mapper";
+			return false;
+		}
+
+		auto& depthPix = kinect->getDepthPixels();
+		auto& bodyIdxPix = kinect->getBodyIndexSource()->getPixels();
+		if (!depthPix.size()) {
+			ofLogError("OccupancyMap::update") << "can't update, no depth pixels read";
+			return false;
+		}
+		if (!bodyIdxPix.size()) {
+			ofLogError("OccupancyMap::update") << "can't update, body index source not allocated";
+			return false;
+		}
+
+		if (dt < 0) dt = ofGetLastFrameTime();
+
+		mapper->MapDepthFrameToCameraSpace(512 * 424, (UINT16*)depthPix.getPixels(), 512 * 424, _cameraPts.data());
+
+		// same transform as Kinect::worldToFloor(), inverted once per frame instead of per px
+		ofMatrix4x4 toFloor = kinect->getFloorTransform().getInverse();
+
+		// bin rows of the depth img, thread 0 writes straight into _coverage
+		int nChunks = std::min(_numThreads, 424);
+		if ((int)_threadCoverage.size() != nChunks - 1) {
+			_threadCoverage.assign(nChunks - 1, vector<float>(_cols * _rows));
+		}
+		const unsigned char* bodyIdx = bodyIdxPix.getPixels();
+		parallelFor(0, 424, nChunks, [&](int y0, int y1, int chunk) {
+			float* coverage = chunk ? _threadCoverage[chunk - 1].data() : _coverage.data();
+			std::fill(coverage, coverage + _cols * _rows, 0.f);
+			binRows(y0, y1, toFloor, bodyIdx, coverage);
+		});
+
+		// merge partial sums, threshold occupancy, decay dwell in place
+
+		const int n = _cols * _rows;
+		float* coverage = _coverage.data();
+		for (auto& partial : _threadCoverage) {
+			const float* src = partial.data();
+			int i = 0;
+#ifdef OFXKINECT2USER_SSE2
+			for (; i + 4 <= n; i += 4) {
+				_mm_storeu_ps(coverage + i, _mm_add_ps(_mm_loadu_ps(coverage + i), _mm_loadu_ps(src + i)));
+			}
+#endif
+			for (; i < n; i++) coverage[i] += src[i];
+		}
+
+		const float decay = _halfLife > 0 ? powf(0.5f, dt / _halfLife) : 1.f;
+		float* occupancy = _occupancy.data();
+		float* dwell = _dwell.data();
+		int i = 0;
+#ifdef OFXKINECT2USER_SSE2
+		const __m128 minCov = _mm_set1_ps(_minCoverage);
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 decay4 = _mm_set1_ps(decay);
+		const __m128 dt4 = _mm_set1_ps(dt);
+		for (; i + 4 <= n; i += 4) {
+			__m128 occ = _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(coverage + i), minCov), one);
+			_mm_storeu_ps(occupancy + i, occ);
+			_mm_storeu_ps(dwell + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(dwell + i), decay4), _mm_mul_ps(occ, dt4)));
+		}
+#endif
+		for (; i < n; i++) {
+			occupancy[i] = coverage[i] >= _minCoverage ? 1.f : 0.f;
+			dwell[i] = dwell[i] * decay + occupancy[i] * dt;
+		}
+
+		return true;
+	}
+
+	void OccupancyMap::binRows(int y0, int y1, const ofMatrix4x4& m, const unsigned char* bodyIdx, float* coverage) {
+
+		// camera xyz -> grid col,row (floor x,z), folded into one affine step
+		const float invCell = 1.f / _cellSize;
+		const float cx = m(0, 0) * invCell, cy = m(1, 0) * invCell, cz = m(2, 0) * invCell;
+		const float cw = (m(3, 0) - _floorBounds.x) * invCell;
+		const float rx = m(0, 2) * invCell, ry = m(1, 2) * invCell, rz = m(2, 2) * invCell;
+		const float rw = (m(3, 2) - _floorBounds.y) * invCell;
+
+		// visible surface of a depth px grows with distance squared
+		const float pxArea = 1.f / (kDepthFocalPx * kDepthFocalPx);
+
+		const CameraSpacePoint* pts = _cameraPts.data();
+		int i = y0 * 512;
+		const int end = y1 * 512;
+
+#ifdef OFXKINECT2USER_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 cols = _mm_set1_ps((float)_cols);
+		const __m128 rows = _mm_set1_ps((float)_rows);
+		alignas(16) int c[4], r[4];
+		alignas(16) float a[4];
+
+		for (; i + 4 <= end; i += 4) {
+
+			int mask = 0;
+			for (int k = 0; k < 4; k++) mask |= isBodyPx(bodyIdx[i + k], _bodyId) << k;
+			if (!mask) continue; // most px are background
+
+			const CameraSpacePoint* p = pts + i;
+			__m128 x = _mm_setr_ps(p[0].X, p[1].X, p[2].X, p[3].X);
+			__m128 y = _mm_setr_ps(p[0].Y, p[1].Y, p[2].Y, p[3].Y);
+			__m128 z = _mm_setr_ps(p[0].Z, p[1].Z, p[2].Z, p[3].Z);
+
+			__m128 col = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(cx)), _mm_mul_ps(y, _mm_set1_ps(cy))),
+									_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(cz)), _mm_set1_ps(cw)));
+			__m128 row = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(rx)), _mm_mul_ps(y, _mm_set1_ps(ry))),
+									_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(rz)), _mm_set1_ps(rw)));
+
+			// invalid depth maps to -inf, fails z > 0
+			__m128 valid = _mm_and_ps(_mm_cmpgt_ps(z, zero),
+							_mm_and_ps(_mm_and_ps(_mm_cmpge_ps(col, zero), _mm_cmplt_ps(col, cols)),
+									   _mm_and_ps(_mm_cmpge_ps(row, zero), _mm_cmplt_ps(row, rows))));
+			mask &= _mm_movemask_ps(valid);
+			if (!mask) continue;
+
+			_mm_store_si128((__m128i*)c, _mm_cvttps_epi32(col)); // >= 0, truncation is floor
+			_mm_store_si128((__m128i*)r, _mm_cvttps_epi32(row));
+			_mm_store_ps(a, _mm_mul_ps(_mm_mul_ps(z, z), _mm_set1_ps(pxArea)));
+
+			for (int k = 0; k < 4; k++) {
+				if (mask & (1 << k)) coverage[r[k] * _cols + c[k]] += a[k];
+			}
+		}
+#endif
+
+		for (; i < end; i++) {
+			if (!isBodyPx(bodyIdx[i], _bodyId)) continue;
+			const CameraSpacePoint& p = pts[i];
+			if (!(p.Z > 0)) continue;
+			float col = p.X * cx + p.Y * cy + p.Z * cz + cw;
+			float row = p.X * rx + p.Y * ry + p.Z * rz + rw;
+			if (col < 0 || row < 0 || col >= _cols || row >= _rows) continue;
+			coverage[(int)row * _cols + (int)col] += p.Z * p.Z * pxArea;
+		}
+	}
+
+	ofVec2f OccupancyMap::cellToFloor(int col, int row) const {
+		return ofVec2f(_floorBounds.x + (col + 0.5) * _cellSize, _floorBounds.y + (row + 0.5) * _cellSize);
+	}
+
+	bool OccupancyMap::floorToCell(ofVec2f floorXZ, int& col, int& row) const {
+		if (!_cols || !_rows) return false;
+		float c = (floorXZ.x - _floorBounds.x) / _cellSize;
+		float r = (floorXZ.y - _floorBounds.y) / _cellSize;
+		if (c < 0 || r < 0 || c >= _cols || r >= _rows) return false;
+		col = (int)c;
+		row = (int)r;
+		return true;
+	}
+
+	void OccupancyMap::draw(Kinect* kinect, float maxDwell, ofColor color) {
+
+		if (!kinect || !_cols || !_rows) return;
+
+		ofPushStyle();
+		ofPushMatrix();
+
+		ofMultMatrix(kinect->getFloorTransform());
+		ofRotate(90, 1, 0, 0); // x-y coords to x-z
+
+		ofFill();
+		ofEnableAlphaBlending();
+		for (int row = 0; row < _rows; row++) {
+			for (int col = 0; col < _cols; col++) {
+				float dwell = _dwell[row * _cols + col];
+				float occ = _occupancy[row * _cols + col];
+				if (dwell <= 0 && occ <= 0) continue;
+				float pct = maxDwell > 0 ? ofClamp(dwell / maxDwell, 0.f, 1.f) : 1.f;
+				ofSetColor(color.r, color.g, color.b, (int)(color.a * std::max(pct, occ * 0.5f)));
+				ofDrawRectangle(_floorBounds.x + col * _cellSize, _floorBounds.y + row * _cellSize, _cellSize, _cellSize);
+			}
+		}
+		ofDisableAlphaBlending();
+
+		ofPopMatrix();
+		ofPopStyle();
+	}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "Kinect.h"
+
+namespace ofxKinectForWindows2 {
+
+	// top-down occupancy grid on the floor plane
+	// body index + depth px are projected into floor space (see Kinect::worldToFloor()) and binned
+	// into fixed cells, giving instantaneous occupancy plus a decaying dwell time (seconds) per cell
+	// all buffers are sized in setup(), update() never allocates
+
+	class OccupancyMap {
+	public:
+
+		OccupancyMap() {}
+		OccupancyMap(ofRectangle floorBounds, float cellSize = 0.1) { setup(floorBounds, cellSize); }
+
+		void setup(ofRectangle floorBounds, float cellSize = 0.1); // floor x,z bounds & cell size in meters
+		void reset(); // clears occupancy & dwell
+
+		void setBodyId(int bodyId)			{ _bodyId = bodyId; }	// -1 for all bodies
+		void setHalfLife(float seconds)		{ _halfLife = seconds; } // dwell decay, <= 0 to never decay
+		void setMinCoverage(float m2)		{ _minCoverage = m2; }	// visible body surface for a cell to count as occupied
+		void setNumThreads(int n)			{ _numThreads = std::max(1, n); }
+
+		bool update(Kinect* kinect, float dt = -1); // dt < 0 uses ofGetLastFrameTime()
+
+		int getCols() const							{ return _cols; }
+		int getRows() const							{ return _rows; }
+		float getCellSize() const					{ return _cellSize; }
+		const ofRectangle& getFloorBounds() const	{ return _floorBounds; }
+
+		bool isOccupied(int col, int row) const		{ return getOccupancy(col, row) > 0; }
+		float getOccupancy(int col, int row) const	{ return inGrid(col, row) ? _occupancy[row * _cols + col] : 0; }
+		float getDwell(int col, int row) const		{ return inGrid(col, row) ? _dwell[row * _cols + col] : 0; }
+		float getCoverage(int col, int row) const	{ return inGrid(col, row) ? _coverage[row * _cols + col] : 0; }
+
+		// row-major, cols x rows
+		const vector<float>& getOccupancyMap() const	{ return _occupancy; }	// 0 or 1
+		const vector<float>& getDwellMap() const		{ return _dwell; }		// decayed seconds occupied
+		const vector<float>& getCoverageMap() const		{ return _coverage; }	// m^2 of body surface this frame
+
+		ofVec2f cellToFloor(int col, int row) const; // cell center, x,z coords
+		bool floorToCell(ofVec2f floorXZ, int& col, int& row) const;
+
+		void draw(Kinect* kinect, float maxDwell = 10., ofColor color = ofColor(255, 120, 0, 200));
+
+	protected:
+
+		bool inGrid(int col, int row) const { return col >= 0 && row >= 0 && col < _cols && row < _rows; }
+		void binRows(int y0, int y1, const ofMatrix4x4& toFloor, const unsigned char* bodyIdx, float* coverage);
+
+		ofRectangle _floorBounds;
+		float _cellSize = 0.1;
+		int _cols = 0, _rows = 0;
+
+		int _bodyId = -1;
+		float _halfLife = 30.;
+		float _minCoverage = 0.01;
+		int _numThreads = 1;
+
+		vector<float> _occupancy;
+		vector<float> _dwell;
+		vector<float> _coverage;
+		vector<vector<float>> _threadCoverage;	// per thread partial sums, merged into _coverage
+		vector<CameraSpacePoint> _cameraPts;	// depth frame in camera space
+	};
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+namespace ofxKinectForWindows2 {
+
+	inline int getNumHardwareThreads() {
+		return std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// persistent worker threads for parallelFor(), started on first use & kept until exit
+	// one run at a time: a call from inside a task (nested) or while another thread's run is busy runs inline
+	class WorkerPool {
+	public:
+
+		static WorkerPool& shared() {
+			static WorkerPool pool;
+			return pool;
+		}
+
+		~WorkerPool() {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_bQuit = true;
+			}
+			_wake.notify_all();
+			for (auto& t : _threads) t.join();
+		}
+
+		// calls task(i) for i in [0, n), the calling thread takes tasks too, returns when all are done
+		void run(int n, const std::function<void(int)>& task) {
+
+			if (n <= 1 || insideRun() || !_runMutex.try_lock()) {
+				for (int i = 0; i < n; i++) task(i);
+				return;
+			}
+			insideRun() = true;
+
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				while ((int)_threads.size() < n - 1) _threads.emplace_back(&WorkerPool::work, this);
+				_task = &task;
+				_next = 0;
+				_count = n;
+				_pending = n;
+			}
+			_wake.notify_all();
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			runTasks(lock);
+			_done.wait(lock, [&] { return _pending == 0; });
+			_task = nullptr;
+			lock.unlock();
+			insideRun() = false;
+			_runMutex.unlock();
+		}
+
+	protected:
+
+		WorkerPool() {}
+
+		// true on pool threads & on a thread while its run() is going, so nesting never re-locks _runMutex
+		static bool& insideRun() {
+			thread_local bool inside = false;
+			return inside;
+		}
+
+		// takes tasks until none are left, lock held on entry & exit
+		void runTasks(std::unique_lock<std::mutex>& lock) {
+			while (_task && _next < _count) {
+				int i = _next++;
+				const std::function<void(int)>* task = _task;
+				lock.unlock();
+				(*task)(i);
+				lock.lock();
+				if (--_pending == 0) _done.notify_all();
+			}
+		}
+
+		void work() {
+			insideRun() = true;
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (true) {
+				_wake.wait(lock, [&] { return _bQuit || (_task && _next < _count); });
+				if (_bQuit) return;
+				runTasks(lock);
+			}
+		}
+
+		std::mutex _runMutex;
+		std::mutex _mutex;
+		std::condition_variable _wake, _done;
+		std::vector<std::thread> _threads;
+		const std::function<void(int)>* _task = nullptr;
+		int _next = 0, _count = 0, _pending = 0;
+		bool _bQuit = false;
+	};
+
+	// splits [begin, end) into nChunks contiguous ranges and calls fn(chunkBegin, chunkEnd, chunkIdx)
+	// for each on the shared worker pool (no thread spawn per call), the calling thread runs chunks too
+	// nChunks <= 1 runs everything inline
+	template<typename Fn>
+	void parallelFor(int begin, int end, int nChunks, Fn fn) {
+
+		int n = end - begin;
+		if (n <= 0) return;
+		nChunks = std::max(1, std::min(nChunks, n));
+		if (nChunks == 1) {
+			fn(begin, end, 0);
+			return;
+		}
+
+		WorkerPool::shared().run(nChunks, [&](int c) {
+			int b = begin + (int)((long long)n * c / nChunks);
+			int e = begin + (int)((long long)n * (c + 1) / nChunks);
+			fn(b, e, c);
+		});
+	}
+
+}
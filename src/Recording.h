@@ -0,0 +1,23 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+
+namespace ofxKinectForWindows2 {
+
+	// one frame of recorded sensor data, enough to replay User::update() & floor logic offline
+	struct RecordedFrame {
+		double time = 0;						// seconds since start of recording
+		Vector4 floorClipPlane = { 0, 0, 0, 0 };
+		vector<Data::Body> bodies;				// one entry per body slot (usually 6), keep the layout fixed across frames
+	};
+
+	// random access source of recorded frames
+	// readers are not shared between threads, every worker opens its own
+	class FrameReader {
+	public:
+		virtual ~FrameReader() {}
+		virtual size_t getNumFrames() = 0;
+		virtual bool readFrame(size_t index, RecordedFrame& frame) = 0; // overwrites frame, reusing its storage
+	};
+
+}
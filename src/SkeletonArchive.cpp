@@ -0,0 +1,609 @@
+#include "SkeletonArchive.h"
+
+namespace ofxKinectForWindows2 {
+
+	namespace {
+
+		typedef SkeletonArchiveWriter::QBody QBody;
+		typedef SkeletonArchiveWriter::QFrame QFrame;
+		typedef SkeletonArchiveWriter::IndexEntry IndexEntry;
+
+		const uint32_t kFileMagic = 0x4153324B;		// "K2SA"
+		const uint32_t kBlockMagic = 0x4253324B;	// "K2SB"
+		const uint32_t kIndexMagic = 0x4953324B;	// "K2SI"
+		const uint32_t kVersion = 1;
+
+		const size_t kHeaderSize = 16;				// magic, version, joint count, frames per block
+		const size_t kBlockHeaderSize = 32;			// magic, frames, slots, payload size, start & end time
+		const size_t kIndexEntrySize = 32;
+		const size_t kTrailerSize = 16;				// index offset, block count, magic
+
+		const uint32_t kMaxFramesPerBlock = 3000;	// bounds what a (corrupt) block header can make the reader allocate
+		const uint32_t kMaxSlots = BODY_COUNT;
+
+		const float kQuatScale = 2047 * sqrt(2.f);	// smallest three are within +-1/sqrt(2), 12 bit
+		const float kFloorScale = 10000;			// floor plane normal & height, 0.1 mm
+
+		template<typename T> void writePod(std::ostream& out, T v) { out.write((const char*)&v, sizeof(T)); }
+		template<typename T> bool readPod(std::istream& in, T& v) { return (bool)in.read((char*)&v, sizeof(T)); }
+
+		// value stream: zigzag LEB128 varints, a run of zeros is written as 0 followed by (run length - 1)
+		class Encoder {
+		public:
+			Encoder(vector<uint8_t>& out) : _out(out) {}
+			void put(int64_t v) {
+				if (v == 0) { _zeros++; return; }
+				flush();
+				varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+			}
+			void flush() {
+				if (!_zeros) return;
+				varint(0);
+				varint(_zeros - 1);
+				_zeros = 0;
+			}
+		private:
+			void varint(uint64_t u) {
+				while (u >= 0x80) {
+					_out.push_back(uint8_t(u) | 0x80);
+					u >>= 7;
+				}
+				_out.push_back(uint8_t(u));
+			}
+			vector<uint8_t>& _out;
+			uint64_t _zeros = 0;
+		};
+
+		class Decoder {
+		public:
+			Decoder(const uint8_t* data, size_t size) : _p(data), _end(data + size) {}
+			int64_t get() {
+				if (_zeros) { _zeros--; return 0; }
+				uint64_t u = varint();
+				if (u == 0) {
+					_zeros = varint();
+					return 0;
+				}
+				return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+			}
+			bool done() const { return _ok && _zeros == 0 && _p == _end; }
+		private:
+			uint64_t varint() {
+				uint64_t u = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					if (_p == _end) break;
+					uint8_t b = *_p++;
+					u |= uint64_t(b & 0x7F) << shift;
+					if (!(b & 0x80)) return u;
+				}
+				_ok = false;
+				return 0;
+			}
+			const uint8_t* _p;
+			const uint8_t* _end;
+			uint64_t _zeros = 0;
+			bool _ok = true;
+		};
+
+		// columns are delta coded frame to frame, differences wrap (unsigned) so tracking ids round trip
+		template<typename Get>
+		void putColumn(Encoder& enc, const vector<const QBody*>& bodies, Get get) {
+			int64_t prev = 0;
+			for (auto* b : bodies) {
+				int64_t v = get(*b);
+				enc.put((int64_t)((uint64_t)v - (uint64_t)prev));
+				prev = v;
+			}
+		}
+
+		template<typename Set>
+		void getColumn(Decoder& dec, const vector<QBody*>& bodies, Set set) {
+			int64_t prev = 0;
+			for (auto* b : bodies) {
+				prev = (int64_t)((uint64_t)prev + (uint64_t)dec.get());
+				set(*b, prev);
+			}
+		}
+
+		// layout: time (2nd order), floor plane, then per slot: tracked, body id, tracking id over all frames,
+		// hand states & joints (per joint, per field) over the frames the slot is tracked in
+		void encodeBlock(const vector<QFrame>& frames, size_t nSlots, vector<uint8_t>& out) {
+
+			Encoder enc(out);
+
+			int64_t prevT = 0, prevD = 0;
+			for (size_t f = 0; f < frames.size(); f++) {
+				int64_t t = frames[f].timeMs;
+				if (f == 0) enc.put(t);
+				else {
+					int64_t d = t - prevT;
+					enc.put(d - prevD);
+					prevD = d;
+				}
+				prevT = t;
+			}
+
+			for (int c = 0; c < 4; c++) {
+				int64_t prev = 0;
+				for (auto& frame : frames) {
+					enc.put(frame.floor[c] - prev);
+					prev = frame.floor[c];
+				}
+			}
+
+			vector<const QBody*> all(frames.size()), tracked;
+			for (size_t s = 0; s < nSlots; s++) {
+				QBody pad; // frames with fewer slots
+				pad.bodyId = (int32_t)s;
+				tracked.clear();
+				for (size_t f = 0; f < frames.size(); f++) {
+					all[f] = s < frames[f].bodies.size() ? &frames[f].bodies[s] : &pad;
+					if (all[f]->tracked) tracked.push_back(all[f]);
+				}
+
+				putColumn(enc, all, [](const QBody& b) { return (int64_t)b.tracked; });
+				putColumn(enc, all, [](const QBody& b) { return (int64_t)b.bodyId; });
+				putColumn(enc, all, [](const QBody& b) { return (int64_t)b.trackingId; });
+				putColumn(enc, tracked, [](const QBody& b) { return (int64_t)b.leftHand; });
+				putColumn(enc, tracked, [](const QBody& b) { return (int64_t)b.rightHand; });
+				for (int j = 0; j < JointType_Count; j++) {
+					for (int k = 0; k < SkeletonArchiveWriter::kJointFields; k++) {
+						putColumn(enc, tracked, [j, k](const QBody& b) { return (int64_t)b.joints[j][k]; });
+					}
+				}
+			}
+
+			enc.flush();
+		}
+
+		bool decodeBlock(const uint8_t* data, size_t size, size_t nFrames, size_t nSlots, vector<QFrame>& frames) {
+
+			Decoder dec(data, size);
+			frames.resize(nFrames);
+
+			int64_t prevT = 0, prevD = 0;
+			for (size_t f = 0; f < nFrames; f++) {
+				if (f == 0) prevT = dec.get();
+				else {
+					prevD += dec.get();
+					prevT += prevD;
+				}
+				frames[f].timeMs = prevT;
+			}
+
+			for (int c = 0; c < 4; c++) {
+				int64_t prev = 0;
+				for (auto& frame : frames) {
+					prev += dec.get();
+					frame.floor[c] = (int32_t)prev;
+				}
+			}
+
+			vector<QBody*> all(nFrames), tracked;
+			for (auto& frame : frames) frame.bodies.resize(nSlots);
+			for (size_t s = 0; s < nSlots; s++) {
+				for (size_t f = 0; f < nFrames; f++) all[f] = &frames[f].bodies[s];
+
+				getColumn(dec, all, [](QBody& b, int64_t v) { b.tracked = (int32_t)v; });
+				getColumn(dec, all, [](QBody& b, int64_t v) { b.bodyId = (int32_t)v; });
+				getColumn(dec, all, [](QBody& b, int64_t v) { b.trackingId = (uint64_t)v; });
+
+				tracked.clear();
+				for (auto* b : all) if (b->tracked) tracked.push_back(b);
+
+				getColumn(dec, tracked, [](QBody& b, int64_t v) { b.leftHand = (int32_t)v; });
+				getColumn(dec, tracked, [](QBody& b, int64_t v) { b.rightHand = (int32_t)v; });
+				for (int j = 0; j < JointType_Count; j++) {
+					for (int k = 0; k < SkeletonArchiveWriter::kJointFields; k++) {
+						getColumn(dec, tracked, [j, k](QBody& b, int64_t v) { b.joints[j][k] = (int32_t)v; });
+					}
+				}
+			}
+
+			return dec.done();
+		}
+
+		void quantizeJoint(const Data::Joint& joint, int32_t* q) {
+
+			q[0] = joint.getTrackingState();
+			ofVec3f p = joint.getPosition();
+			q[1] = (int32_t)std::lround(p.x * 1000);
+			q[2] = (int32_t)std::lround(p.y * 1000);
+			q[3] = (int32_t)std::lround(p.z * 1000);
+
+			// smallest three: drop the largest component (sign flipped positive), keep which one it was
+			// leaf joints (head, feet, hand tips, thumbs) come without orientation, stored as index 4
+			ofVec4f o = joint.getOrientation().asVec4();
+			float c[4] = { o.x, o.y, o.z, o.w };
+			float len2 = c[0] * c[0] + c[1] * c[1] + c[2] * c[2] + c[3] * c[3];
+			if (len2 < 1e-8f) {
+				q[4] = 4;
+				q[5] = q[6] = q[7] = 0;
+				return;
+			}
+			int m = 0;
+			for (int i = 1; i < 4; i++) if (fabs(c[i]) > fabs(c[m])) m = i;
+			float s = (c[m] < 0 ? -kQuatScale : kQuatScale) / sqrt(len2);
+			q[4] = m;
+			for (int i = 0, k = 5; i < 4; i++) {
+				if (i != m) q[k++] = (int32_t)std::lround(c[i] * s);
+			}
+		}
+
+		Data::Joint dequantizeJoint(JointType type, const int32_t* q) {
+
+			_Joint joint;
+			joint.JointType = type;
+			joint.Position.X = q[1] / 1000.f;
+			joint.Position.Y = q[2] / 1000.f;
+			joint.Position.Z = q[3] / 1000.f;
+			joint.TrackingState = (TrackingState)q[0];
+
+			float c[4] = { 0, 0, 0, 0 };
+			if (q[4] >= 0 && q[4] < 4) {
+				float sum = 0;
+				for (int i = 0, k = 5; i < 4; i++) {
+					if (i == q[4]) continue;
+					c[i] = q[k++] / kQuatScale;
+					sum += c[i] * c[i];
+				}
+				c[q[4]] = sqrt(std::max(0.f, 1.f - sum));
+			}
+
+			_JointOrientation orientation;
+			orientation.JointType = type;
+			orientation.Orientation = { c[0], c[1], c[2], c[3] };
+
+			return Data::Joint(joint, orientation);
+		}
+	}
+
+	//----------------------------------------------------------------
+	bool SkeletonArchiveWriter::open(const string& path, int framesPerBlock) {
+
+		close();
+
+		_file.open(ofToDataPath(path), std::ios::binary | std::ios::trunc);
+		if (!_file.is_open()) {
+			ofLogError("SkeletonArchiveWriter::open") << "can't open " << path;
+			return false;
+		}
+
+		_framesPerBlock = ofClamp(framesPerBlock, 1, (int)kMaxFramesPerBlock);
+		_pending.clear();
+		_pending.reserve(_framesPerBlock);
+		_index.clear();
+		_numFrames = 0;
+
+		writePod(_file, kFileMagic);
+		writePod(_file, kVersion);
+		writePod(_file, (uint32_t)JointType_Count);
+		writePod(_file, (uint32_t)_framesPerBlock);
+
+		return _file.good();
+	}
+
+	bool SkeletonArchiveWriter::addFrame(double time, const vector<Data::Body>& bodies, Vector4 floorClipPlane) {
+
+		if (!isOpen()) {
+			ofLogError("SkeletonArchiveWriter::addFrame") << "can't add frame, archive not open";
+			return false;
+		}
+
+		if (bodies.size() > kMaxSlots) {
+			ofLogError("SkeletonArchiveWriter::addFrame") << "can't add frame, " << bodies.size() << " body slots (max " << kMaxSlots << ")";
+			return false;
+		}
+
+		QFrame qf;
+		qf.timeMs = std::llround(time * 1000);
+		if (_pending.size() && qf.timeMs < _pending.back().timeMs) {
+			ofLogError("SkeletonArchiveWriter::addFrame") << "can't add frame, time " << time << " is before the previous frame";
+			return false;
+		}
+		if (_pending.empty() && _index.size() && qf.timeMs < std::llround(_index.back().endTime * 1000)) {
+			ofLogError("SkeletonArchiveWriter::addFrame") << "can't add frame, time " << time << " is before the previous frame";
+			return false;
+		}
+
+		qf.floor[0] = (int32_t)std::lround(floorClipPlane.x * kFloorScale);
+		qf.floor[1] = (int32_t)std::lround(floorClipPlane.y * kFloorScale);
+		qf.floor[2] = (int32_t)std::lround(floorClipPlane.z * kFloorScale);
+		qf.floor[3] = (int32_t)std::lround(floorClipPlane.w * kFloorScale);
+
+		qf.bodies.resize(bodies.size());
+		for (size_t s = 0; s < bodies.size(); s++) {
+			const Data::Body& body = bodies[s];
+			QBody& qb = qf.bodies[s];
+			qb.tracked = body.tracked;
+			qb.bodyId = body.bodyId;
+			qb.trackingId = body.trackingId;
+			if (!body.tracked) continue;
+			qb.leftHand = body.leftHandState;
+			qb.rightHand = body.rightHandState;
+			for (int j = 0; j < JointType_Count; j++) {
+				auto joint = body.joints.find((JointType)j);
+				if (joint != body.joints.end()) quantizeJoint(joint->second, qb.joints[j]);
+				else qb.joints[j][4] = 4; // not tracked, no orientation
+			}
+		}
+
+		_pending.push_back(std::move(qf));
+		_numFrames++;
+
+		if ((int)_pending.size() >= _framesPerBlock) return flushBlock();
+		return true;
+	}
+
+	bool SkeletonArchiveWriter::flushBlock() {
+
+		if (_pending.empty()) return true;
+
+		size_t nSlots = 0;
+		for (auto& frame : _pending) nSlots = std::max(nSlots, frame.bodies.size());
+
+		_buffer.clear();
+		encodeBlock(_pending, nSlots, _buffer);
+
+		IndexEntry entry;
+		entry.startTime = _pending.front().timeMs / 1000.;
+		entry.endTime = _pending.back().timeMs / 1000.;
+		entry.offset = (uint64_t)_file.tellp();
+		entry.firstFrame = (uint32_t)(_numFrames - _pending.size());
+		entry.numFrames = (uint32_t)_pending.size();
+
+		writePod(_file, kBlockMagic);
+		writePod(_file, entry.numFrames);
+		writePod(_file, (uint32_t)nSlots);
+		writePod(_file, (uint32_t)_buffer.size());
+		writePod(_file, entry.startTime);
+		writePod(_file, entry.endTime);
+		_file.write((const char*)_buffer.data(), _buffer.size());
+		_file.flush(); // a crash loses at most the pending block
+
+		_index.push_back(entry);
+		_pending.clear();
+
+		if (!_file.good()) {
+			ofLogError("SkeletonArchiveWriter::flushBlock") << "can't write block " << _index.size() - 1;
+			return false;
+		}
+		return true;
+	}
+
+	bool SkeletonArchiveWriter::close() {
+
+		if (!isOpen()) return true;
+
+		bool ok = flushBlock();
+
+		uint64_t indexOffset = (uint64_t)_file.tellp();
+		for (auto& entry : _index) {
+			writePod(_file, entry.startTime);
+			writePod(_file, entry.endTime);
+			writePod(_file, entry.offset);
+			writePod(_file, entry.firstFrame);
+			writePod(_file, entry.numFrames);
+		}
+		writePod(_file, indexOffset);
+		writePod(_file, (uint32_t)_index.size());
+		writePod(_file, kIndexMagic);
+
+		ok = ok && _file.good();
+		if (!ok) ofLogError("SkeletonArchiveWriter::close") << "can't write time index";
+
+		_file.close();
+		_pending.clear();
+		_index.clear();
+		return ok;
+	}
+
+	//----------------------------------------------------------------
+	bool SkeletonArchiveReader::open(const string& path) {
+
+		close();
+
+		_file.open(ofToDataPath(path), std::ios::binary);
+		if (!_file.is_open()) {
+			ofLogError("SkeletonArchiveReader::open") << "can't open " << path;
+			return false;
+		}
+
+		uint32_t magic = 0, version = 0, nJoints = 0, framesPerBlock = 0;
+		readPod(_file, magic);
+		readPod(_file, version);
+		readPod(_file, nJoints);
+		readPod(_file, framesPerBlock);
+		if (!_file || magic != kFileMagic || version != kVersion || nJoints != JointType_Count) {
+			ofLogError("SkeletonArchiveReader::open") << "can't open " << path << ", not a skeleton archive (version " << kVersion << ")";
+			close();
+			return false;
+		}
+		if (framesPerBlock < 1 || framesPerBlock > kMaxFramesPerBlock) {
+			ofLogError("SkeletonArchiveReader::open") << "can't open " << path << ", bad header (" << framesPerBlock << " frames per block)";
+			close();
+			return false;
+		}
+		_framesPerBlock = framesPerBlock;
+
+		_file.seekg(0, std::ios::end);
+		uint64_t end = (uint64_t)_file.tellg();
+		_fileSize = end;
+
+		// time index from the trailer
+		uint64_t indexOffset = 0;
+		uint32_t nBlocks = 0;
+		bool indexed = false;
+		if (end >= kHeaderSize + kTrailerSize) {
+			_file.seekg(end - kTrailerSize);
+			readPod(_file, indexOffset);
+			readPod(_file, nBlocks);
+			readPod(_file, magic);
+			indexed = _file && magic == kIndexMagic
+				&& indexOffset + (uint64_t)nBlocks * kIndexEntrySize + kTrailerSize == end;
+		}
+
+		if (indexed) {
+			// nBlocks is bounded by the file size (checked above), entries must describe blocks before the index
+			_file.seekg(indexOffset);
+			_index.resize(nBlocks);
+			uint64_t firstFrame = 0;
+			for (auto& entry : _index) {
+				readPod(_file, entry.startTime);
+				readPod(_file, entry.endTime);
+				readPod(_file, entry.offset);
+				readPod(_file, entry.firstFrame);
+				readPod(_file, entry.numFrames);
+				if (entry.numFrames < 1 || entry.numFrames > _framesPerBlock || entry.firstFrame != firstFrame
+					|| entry.offset < kHeaderSize || entry.offset + kBlockHeaderSize > indexOffset) {
+					indexed = false;
+					break;
+				}
+				firstFrame += entry.numFrames;
+			}
+			indexed = indexed && (bool)_file;
+		}
+
+		if (!indexed) {
+			ofLogWarning("SkeletonArchiveReader::open") << path << " has no valid time index (writer not closed?), rebuilding from blocks";
+			_file.clear();
+			if (!rebuildIndex(end)) {
+				close();
+				return false;
+			}
+		}
+
+		_numFrames = _index.size() ? _index.back().firstFrame + _index.back().numFrames : 0;
+		return true;
+	}
+
+	bool SkeletonArchiveReader::rebuildIndex(uint64_t end) {
+
+		_index.clear();
+		uint64_t offset = kHeaderSize;
+		uint32_t firstFrame = 0;
+
+		while (offset + kBlockHeaderSize <= end) {
+			uint32_t magic = 0, nFrames = 0, nSlots = 0, size = 0;
+			IndexEntry entry;
+			_file.seekg(offset);
+			readPod(_file, magic);
+			readPod(_file, nFrames);
+			readPod(_file, nSlots);
+			readPod(_file, size);
+			readPod(_file, entry.startTime);
+			readPod(_file, entry.endTime);
+			if (!_file || magic != kBlockMagic || offset + kBlockHeaderSize + size > end) break; // truncated block
+			if (nFrames < 1 || nFrames > _framesPerBlock || nSlots > kMaxSlots) break; // corrupt header
+
+			entry.offset = offset;
+			entry.firstFrame = firstFrame;
+			entry.numFrames = nFrames;
+			_index.push_back(entry);
+
+			firstFrame += nFrames;
+			offset += kBlockHeaderSize + size;
+		}
+
+		_file.clear();
+		return true;
+	}
+
+	void SkeletonArchiveReader::close() {
+		if (_file.is_open()) _file.close();
+		_file.clear();
+		_index.clear();
+		_numFrames = 0;
+		_framesPerBlock = 0;
+		_fileSize = 0;
+		_cachedBlock = -1;
+		_cache.clear();
+	}
+
+	bool SkeletonArchiveReader::loadBlock(size_t block) {
+
+		if (_cachedBlock == (int)block) return true;
+		_cachedBlock = -1;
+
+		const IndexEntry& entry = _index[block];
+		uint32_t magic = 0, nFrames = 0, nSlots = 0, size = 0;
+		_file.seekg(entry.offset);
+		readPod(_file, magic);
+		readPod(_file, nFrames);
+		readPod(_file, nSlots);
+		readPod(_file, size);
+		_file.seekg(entry.offset + kBlockHeaderSize);
+
+		if (!_file || magic != kBlockMagic || nFrames != entry.numFrames || nFrames > _framesPerBlock
+			|| nSlots > kMaxSlots || entry.offset + kBlockHeaderSize + size > _fileSize) {
+			ofLogError("SkeletonArchiveReader::loadBlock") << "can't read block " << block << ", bad header";
+			_file.clear();
+			return false;
+		}
+
+		_buffer.resize(size);
+		_file.read((char*)_buffer.data(), size);
+		if (!_file || !decodeBlock(_buffer.data(), size, nFrames, nSlots, _cache)) {
+			ofLogError("SkeletonArchiveReader::loadBlock") << "can't decode block " << block << ", data corrupt";
+			_file.clear();
+			return false;
+		}
+
+		_cachedBlock = (int)block;
+		return true;
+	}
+
+	bool SkeletonArchiveReader::readFrame(size_t index, RecordedFrame& frame) {
+
+		if (index >= _numFrames) {
+			ofLogError("SkeletonArchiveReader::readFrame") << "can't read frame " << index << ", archive has " << _numFrames;
+			return false;
+		}
+
+		auto it = std::upper_bound(_index.begin(), _index.end(), index,
+			[](size_t i, const IndexEntry& entry) { return i < entry.firstFrame; });
+		size_t block = (it - _index.begin()) - 1;
+		if (!loadBlock(block)) return false;
+
+		const QFrame& qf = _cache[index - _index[block].firstFrame];
+		frame.time = qf.timeMs / 1000.;
+		frame.floorClipPlane = { qf.floor[0] / kFloorScale, qf.floor[1] / kFloorScale, qf.floor[2] / kFloorScale, qf.floor[3] / kFloorScale };
+
+		frame.bodies.resize(qf.bodies.size());
+		for (size_t s = 0; s < qf.bodies.size(); s++) {
+			const QBody& qb = qf.bodies[s];
+			Data::Body& body = frame.bodies[s];
+			body.bodyId = qb.bodyId;
+			body.trackingId = qb.trackingId;
+			body.tracked = qb.tracked != 0;
+			if (!body.tracked) {
+				body.leftHandState = body.rightHandState = HandState_Unknown;
+				body.joints.clear();
+				continue;
+			}
+			body.leftHandState = (HandState)qb.leftHand;
+			body.rightHandState = (HandState)qb.rightHand;
+			for (int j = 0; j < JointType_Count; j++) {
+				body.joints[(JointType)j] = dequantizeJoint((JointType)j, qb.joints[j]);
+			}
+		}
+
+		return true;
+	}
+
+	size_t SkeletonArchiveReader::getFrameAt(double time) {
+
+		// first block still running at time, then the frame within it
+		auto it = std::lower_bound(_index.begin(), _index.end(), time,
+			[](const IndexEntry& entry, double t) { return entry.endTime < t; });
+		if (it == _index.end()) return _numFrames;
+
+		size_t block = it - _index.begin();
+		if (!loadBlock(block)) return _numFrames;
+
+		auto frame = std::lower_bound(_cache.begin(), _cache.end(), time,
+			[](const QFrame& qf, double t) { return qf.timeMs / 1000. < t; });
+		return it->firstFrame + (frame - _cache.begin());
+	}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "Recording.h"
+
+namespace ofxKinectForWindows2 {
+
+	// compact, seekable long-term storage of skeleton data (bodies + floor plane, no images)
+	//
+	// positions are fixed point mm, orientations smallest-three quaternions (12 bit components)
+	// frames are grouped into blocks, inside a block every value is delta coded against the
+	// previous frame (time second order) and written as zigzag varints with zero runs collapsed,
+	// so still joints cost next to nothing and moving ones a few bytes
+	// blocks decode on their own, a time index at the end of the file makes seeking one read + one block decode
+	// if the index is missing (writer never closed) the reader rebuilds it from the block headers
+	//
+	// file: header | block... | index | trailer, little endian
+
+	class SkeletonArchiveWriter {
+	public:
+
+		~SkeletonArchiveWriter() { close(); }
+
+		bool open(const string& path, int framesPerBlock = 300); // 10 s @ 30 fps, 1 - 3000
+		bool close(); // writes the last block & time index
+		bool isOpen() const { return _file.is_open(); }
+
+		bool addFrame(double time, const vector<Data::Body>& bodies, Vector4 floorClipPlane = { 0, 0, 0, 0 });
+		bool addFrame(const RecordedFrame& frame) { return addFrame(frame.time, frame.bodies, frame.floorClipPlane); }
+
+		size_t getNumFrames() const { return _numFrames; }
+
+		// quantized frame, shared with the reader
+		static const int kJointFields = 8; // state, x, y, z (mm), largest quat component (4 = zero quat), 3 smallest
+		struct QBody {
+			int32_t tracked = 0, bodyId = 0, leftHand = 0, rightHand = 0;
+			uint64_t trackingId = 0;
+			int32_t joints[JointType_Count][kJointFields] = {};
+		};
+		struct QFrame {
+			int64_t timeMs = 0;
+			int32_t floor[4];
+			vector<QBody> bodies;
+		};
+		struct IndexEntry {
+			double startTime, endTime;
+			uint64_t offset;
+			uint32_t firstFrame, numFrames;
+		};
+
+	protected:
+
+		bool flushBlock();
+
+		std::ofstream _file;
+		int _framesPerBlock = 300;
+		vector<QFrame> _pending;
+		vector<IndexEntry> _index;
+		vector<uint8_t> _buffer;
+		size_t _numFrames = 0;
+	};
+
+	class SkeletonArchiveReader : public FrameReader {
+	public:
+
+		bool open(const string& path);
+		void close();
+		bool isOpen() const { return _file.is_open(); }
+
+		size_t getNumFrames() override { return _numFrames; }
+		bool readFrame(size_t index, RecordedFrame& frame) override;
+
+		size_t getFrameAt(double time);	// first frame at or after time (seconds), getNumFrames() if past the end
+		double getStartTime() const		{ return _index.size() ? _index.front().startTime : 0; }
+		double getEndTime() const		{ return _index.size() ? _index.back().endTime : 0; }
+		size_t getNumBlocks() const		{ return _index.size(); }
+
+	protected:
+
+		typedef SkeletonArchiveWriter::QFrame QFrame;
+		typedef SkeletonArchiveWriter::IndexEntry IndexEntry;
+
+		bool loadBlock(size_t block);
+		bool rebuildIndex(uint64_t end);
+
+		std::ifstream _file;
+		vector<IndexEntry> _index;
+		size_t _numFrames = 0;
+		uint32_t _framesPerBlock = 0;	// from the header, bounds every block
+		uint64_t _fileSize = 0;
+
+		int _cachedBlock = -1;
+		vector<QFrame> _cache;
+		vector<uint8_t> _buffer;
+	};
+
+}
@@ -1,23 +1,78 @@
 #include "User.h"
+#include "UserCache.h"
+#include "core/Simd.h"
+#include "core/MeshBuilder.h"
 
 namespace ofxKinectForWindows2 {
 
 	bool User::setBody(kBody* bodyPtr) { // returns true if change to user
 		
 		if ((!bodyPtr && !_bodyPtr) || ( bodyPtr == _bodyPtr)) return _bUserChanged = false;
+
+		if (_cache && _bodyPtr) _cache->remember(*this); // body lost, keep state for a while
 		
 		_bodyPtr = bodyPtr;
-		_startTime = bodyPtr ? ofGetElapsedTimef() : 0; // 0 if null body
+		_startTime = bodyPtr ? now() : 0; // 0 if null body
 		_pJoints.clear(); _joints.clear();  			// new body, clear joint history
 
 		ofLogVerbose("ofxKFW2::User") << "set new body - ptr: " << (bodyPtr ? ofToString(bodyPtr) : "null");
-		return _bUserChanged = true;
+		_bUserChanged = true;
+
+		if (_cache && _bAutoRecall && bodyPtr) _cache->recall(*this); // returning body?
+		return _bUserChanged;
+	}
+
+	User::State User::getState() const {
+		State state;
+		state.startTime = _startTime;
+		state.joints = _joints;
+		state.pJoints = _pJoints;
+		state.handStates = _handStates;
+		state.pHandStates = _pHandStates;
+		return state;
+	}
+
+	void User::restoreState(const State& state) {
+		_startTime = state.startTime;
+		_joints = state.joints;
+		_pJoints = state.pJoints;
+		_handStates = state.handStates;
+		_pHandStates = state.pHandStates;
+		_bUserChanged = false;
 	}
 
 	// update
 	// ---------------------------------------------------------------------------
 
 	bool User::update(float lerp, float inferLerp) {
+		core::SkeletonUpdate update;
+		if (!beginUpdate(lerp, inferLerp, update)) return false;
+		core::updateSkeletons(&update, 1);
+		endUpdate();
+		return true;
+	}
+
+	int User::update(const vector<User*>& users, float lerp, float inferLerp) {
+
+		// one skeleton kernel call for everyone (SoA joint transforms, see core::updateSkeletons())
+		vector<core::SkeletonUpdate> updates;
+		vector<User*> updated;
+		updates.reserve(users.size());
+		updated.reserve(users.size());
+		for (User* user : users) {
+			if (!user) continue;
+			core::SkeletonUpdate update;
+			if (!user->beginUpdate(lerp, inferLerp, update)) continue;
+			updates.push_back(update);
+			updated.push_back(user);
+		}
+		if (updates.size()) core::updateSkeletons(updates.data(), (int)updates.size());
+		for (User* user : updated) user->endUpdate();
+
+		return (int)updated.size();
+	}
+
+	bool User::beginUpdate(float lerp, float inferLerp, core::SkeletonUpdate& update) {
 
 		// save and clear joint positions
 		if (_pJoints.size() == 0) lerp = inferLerp = 1.; // brand new user, no lerp this time
@@ -32,73 +87,60 @@ namespace ofxKinectForWindows2 {
 			ofLogVerbose("ofxKFW2::User") << "can't update, no body";
 			return false;
 		}
-		if (!hasCoordinateMapper()) {
+		if (_bProject2d && !hasCoordinateMapper()) {
 			ofLogVerbose("ofxKFW2::User") << "can't update, no coordinate mapper";
 			return false;
 		}
 
 		auto& joints = _bodyPtr->joints; // raw joints from kinect
 
-		// calc new joint positions (world > color coords)
+		// last frame & this frame's raw joints into the core skeleton
+		_skeletonPrev = core::Joints();
+		_skeleton = core::Joints();
+		for (auto& joint : _pJoints) {
+			core::Joint& c = _skeletonPrev[joint.first];
+			c.valid = true;
+			c.state = joint.second.state;
+			c.posRaw = toCore(joint.second.pos3dRaw);
+			c.orientationRaw = toCore(joint.second.orientationRaw);
+		}
 		for (auto& joint : joints) {
+			core::Joint& c = _skeleton[joint.first];
+			c.valid = true;
+			c.state = joint.second.getTrackingState();
+			c.posRaw = toCore(joint.second.getPosition());
+			c.orientationRaw = toCore(joint.second.getOrientation());
+		}
 
-			// grab basic joint data
-
-			ofVec3f& p3dRaw		= _joints[joint.first].pos3dRaw			= joint.second.getPosition();
-			ofQuaternion& oRaw	= _joints[joint.first].orientationRaw	= joint.second.getOrientation();
-			ofVec3f& p3d		= _joints[joint.first].pos3d;
-			ofQuaternion& ori	= _joints[joint.first].orientation;
-			ofVec2f& p2d		= _joints[joint.first].pos2d			= joint.second.getProjected(_coordMapperPtr);
-			auto& tState		= _joints[joint.first].state			= joint.second.getTrackingState();
-
-
-			float l = (tState == TrackingState_Tracked) ? lerp : inferLerp;
-
-			// lerp, must be 0-1
-			if (l > 0 && l < 1) {
-				auto& prevJoint = _pJoints.at(joint.first);
-				p3dRaw	= prevJoint.pos3dRaw.getInterpolated(p3dRaw, l);
-				oRaw.slerp(l, prevJoint.orientationRaw, oRaw);
-			}
-								  
-			// transform 
-
-			// position
-			
-			p3d = p3dRaw * getGlobalTransformMatrix();
-
-			// orientation
-
-			ori = oRaw;
-
-			if (_bMirrorX) {
-
-				// mirror 2d
-				p2d.x = 1920 - p2d.x; // flip within color space
-
-				p3d = p3d * reflection;
-
-				// mirror 3d orientation - done above by arbitrary axis
-				ofVec4f oRaw4 = oRaw.asVec4();
-				oRaw4.x *= -1;
-				oRaw4.w *= -1;
-				ori.set(oRaw4);
-			}
-			else if (!reflection.isIdentity()){
-				ofVec4f ori4 = oRaw.asVec4();
-				ofVec3f ori3 = ori4;
-				ori3 = ori3 * reflection;
-				ori.set(ori3.x,ori3.y,ori3.z,-1.*ori4.w); // fingers crossed...
-			}
+		// lerp & transform (world > color coords), node matrix once per frame
+		update.joints = &_skeleton;
+		update.prev = _pJoints.size() ? &_skeletonPrev : nullptr;
+		update.lerp = lerp;
+		update.inferLerp = inferLerp;
+		update.transform.global = toCore(getGlobalTransformMatrix());
+		update.transform.reflection = toCore(reflection);
+		update.transform.mirrorX = _bMirrorX;
+		return true;
+	}
 
+	void User::endUpdate() {
 
+		auto& joints = _bodyPtr->joints;
+		for (auto& joint : joints) {
+			const core::Joint& c = _skeleton[joint.first];
+			JointData& data = _joints[joint.first];
+			data.pos3dRaw		= toOf(c.posRaw);
+			data.orientationRaw	= toOf(c.orientationRaw);
+			data.pos3d			= toOf(c.pos);
+			data.orientation	= toOf(c.orientation);
+			data.state			= joint.second.getTrackingState();
+			data.pos2d			= _bProject2d ? joint.second.getProjected(_coordMapperPtr) : ofVec2f();
+			if (_bMirrorX) data.pos2d.x = 1920 - data.pos2d.x; // flip within color space
 		}
 
 		// get new hand states
 		_handStates.left = _bodyPtr->leftHandState;
 		_handStates.right = _bodyPtr->rightHandState;
-
-		return true;
 	}
 
 	bool User::jointExists(JointType type, bool prev) {
@@ -286,168 +328,309 @@ namespace ofxKinectForWindows2 {
 		ofPopStyle();
 	}
 
-	bool User::buildMesh(Kinect* kinect, int step, float facesMaxLength) {
+	bool User::prepareMesh(Kinect* kinect, const string& logTag) {
 
 		// get body id
 		if (_bodyPtr == nullptr) {
-			ofLogError("User::buildMesh") << "can't build mesh, no user / body!";
+			ofLogError(logTag) << "can't build mesh, no user / body!";
 			return false;
 		}
 		const auto& bodyId = _bodyPtr->bodyId;
 		if (bodyId < 0 || bodyId > 5) {
-			ofLogError("User::buildMesh") << " can't build mesh, invalid bodyId: " << bodyId;
+			ofLogError(logTag) << " can't build mesh, invalid bodyId: " << bodyId;
 			return false;
 		}
 
 		// get kinect
 		if (kinect == nullptr) {
-			ofLogError("User::buildMesh") << "can't build mesh, kinect is null";
+			ofLogError(logTag) << "can't build mesh, kinect is null";
 			return false;
 		}
 		// check coordinate mapper
 		if (_coordMapperPtr == nullptr) {
-			ofLogError("User::buildMesh") << "can't build mesh, no coordinate mapper";
+			ofLogError(logTag) << "can't build mesh, no coordinate mapper";
 			return false;
 		}
 
 		// depth, body index and color sources
-		auto& depthPix = kinect->getDepthSource()->getPixels();
+		auto& depthPix = kinect->getDepthPixels();
 		auto& bodyIdxPix = kinect->getBodyIndexSource()->getPixels();
 		auto& colorPix = kinect->getColorSource()->getPixels();
 		if (!depthPix.size()) {
-			ofLogError("User::buildMesh") << "can't build mesh, no depth pixels read";
+			ofLogError(logTag) << "can't build mesh, no depth pixels read";
 			return false;
 		}
 		if (!bodyIdxPix.size()) {
-			ofLogError("User::buildMesh") << "can't build mesh,  body index source not allocated";
+			ofLogError(logTag) << "can't build mesh,  body index source not allocated";
 			return false;
 		}
 		if (!colorPix.size()) {
-			ofLogError("User::buildMesh") << "can't build mesh, color index source not allocated";
+			ofLogError(logTag) << "can't build mesh, color index source not allocated";
 			return false;
 		}
 
-		// get color coords of depth pixels
-		// maybe just do this once?
-		_coordMapperPtr->MapDepthFrameToColorSpace(512 * 424, (UINT16*)depthPix.getPixels(), 512 * 424, (ColorSpacePoint*)_depthToColorCoords.data());
-
-		// loop through body idx pix
-		//
-		// mesh triangle formatting:
-		//  tl.____t.
-		//    |\   /|
-		//    |  X  |
-		//  l.|/___\|
-		//          *i
-		//
-		bool isBody[512 * 424]; // tracks body status in depth img
-
-		// MESH generator
+		// get color coords of depth pixels, mapped once per frame for all users
+		auto& depthToColor = kinect->getDepthToColorCoords();
+		if (depthToColor.empty()) {
+			ofLogError(logTag) << "can't build mesh, can't map depth to color space";
+			return false;
+		}
 
 		// prep mesh
 		_userMesh.clear();
 		_userMesh.setMode(OF_PRIMITIVE_TRIANGLES);
 
 		// add color img texture coords
-		_userMesh.addTexCoords(_depthToColorCoords);
+		_userMesh.addTexCoords(depthToColor);
 
 		// add depth->camera space vertices
 		_userMesh.getVertices().resize(512 * 424);
 		_coordMapperPtr->MapDepthFrameToCameraSpace(512 * 424, (UINT16*)depthPix.getPixels(), 512 * 424, (CameraSpacePoint*)_userMesh.getVerticesPointer());
-		auto vertices = _userMesh.getVerticesPointer();
 
-		// loop through body idx px, find body px, add indices to mesh
-		for (int y = 0; y <= 424 - step; y += step) {
-			for (int x = 0; x <= 512 - step; x += step) {
+		return true;
+	}
 
-				// indices in body idx px
-				int i = y * 512 + x;
-				int t = i - 512 * step;
-				int l = i - step;
-				int tl = l - 512 * step;
-
-				// check if body idx color is this body
-				int val = roundf(bodyIdxPix[i]);
-				if (val == bodyId) {
-					isBody[i] = true; // part of the body
-				}
-				else isBody[i] = false;
+	bool User::buildMesh(Kinect* kinect, int step, float facesMaxLength) {
 
-				if (t < 0 || l < 0) continue; // other points outside frame, move on
+		if (!prepareMesh(kinect, "User::buildMesh")) return false;
 
-				// check for triangles within body
+		core::triangulate((const core::Vec3*)_userMesh.getVerticesPointer(),
+						  kinect->getBodyIndexSource()->getPixels().getPixels(), _bodyPtr->bodyId,
+						  step, facesMaxLength, _userMesh.getIndices());
+		return true;
+	}
 
-				// camera space points
-				const ofVec3f & v = vertices[i];
-				const ofVec3f & vT = vertices[t];
-				const ofVec3f & vL = vertices[l];
-				const ofVec3f & vTL = vertices[tl];
+	bool User::buildMeshAdaptive(Kinect* kinect, int maxTriangles, float facesMaxLength) {
 
-				if (isBody[i] && !isBody[tl]) { // only one triangle option
+		if (!prepareMesh(kinect, "User::buildMeshAdaptive")) return false;
 
-					if (isBody[t] && isBody[l]) {
-						// make triangle:
-						//   /|
-						// /__|
+		core::triangulateAdaptive((core::Vec3*)_userMesh.getVerticesPointer(), (core::Vec2*)_userMesh.getTexCoordsPointer(),
+								  kinect->getBodyIndexSource()->getPixels().getPixels(), (const uint16_t*)kinect->getDepthPixels().getPixels(),
+								  _bodyPtr->bodyId, maxTriangles, facesMaxLength, _userMesh.getIndices());
+		return true;
+	}
 
-						// check distance
-						if (v.z > 0 && vT.z > 0 && vL.z > 0
-							&& abs(v.z - vT.z) < facesMaxLength
-							&& abs(v.z - vL.z) < facesMaxLength) {
-							const ofIndexType indices[3] = { i, t, l };
-							_userMesh.addIndices(indices, 3);
-						}
-					}
-				}
-				else if (isBody[tl] && !isBody[i]) { // only one triangle option
-
-					if (isBody[t] && isBody[l]) {
-						// make triangle:
-						// ____
-						// |  /
-						// |/
-
-						// check distance
-						if (vTL.z > 0 && vT.z > 0 && vL.z > 0
-							&& abs(vTL.z - vT.z) < facesMaxLength
-							&& abs(vTL.z - vL.z) < facesMaxLength) {
-							const ofIndexType indices[3] = { tl, t, l };
-							_userMesh.addIndices(indices, 3);
-						}
-					}
+	namespace {
+
+		// depth res cutout row: color px gathered through depth->color coords for every body px
+		void gatherCutoutRow(const float* depthToColor, const unsigned char* bodyIdx, int bodyId,
+							 const uint32_t* color, uint32_t* out, int n) {
+			int i = 0;
+#ifdef OFXKINECT2USER_SSE2
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 w = _mm_set1_ps(1920.f);
+			const __m128 h = _mm_set1_ps(1080.f);
+			const __m128i id = _mm_set1_epi32(bodyId);
+			const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+			for (; i + 4 <= n; i += 4) {
+				__m128i body = _mm_cmpeq_epi32(_mm_setr_epi32(bodyIdx[i], bodyIdx[i + 1], bodyIdx[i + 2], bodyIdx[i + 3]), id);
+				if (!_mm_movemask_epi8(body)) {
+					_mm_storeu_si128((__m128i*)(out + i), _mm_setzero_si128());
+					continue;
 				}
-				else { // both i and tl are body, try inverted triangles
-					if (isBody[l]) {
-						// make triangle:
-						// |\
-						// |__\
-
-						// check distance
-						if (v.z > 0 && vTL.z > 0 && vL.z > 0
-							&& abs(v.z - vTL.z) < facesMaxLength
-							&& abs(v.z - vL.z) < facesMaxLength) {
-							const ofIndexType indices[3] = { i, tl, l };
-							_userMesh.addIndices(indices, 3);
-						}
-					}
-					if (isBody[t]) {
-						// make triangle:
-						// ____
-						// \  |
-						//   \|
-
-						// check distance
-						if (v.z > 0 && vTL.z > 0 && vT.z > 0
-							&& abs(v.z - vTL.z) < facesMaxLength
-							&& abs(v.z - vT.z) < facesMaxLength) {
-							const ofIndexType indices[3] = { i, tl, t };
-							_userMesh.addIndices(indices, 3);
-						}
-					}
+
+				// de-interleave x,y pairs, round to nearest px
+				__m128 a = _mm_loadu_ps(depthToColor + 2 * i);
+				__m128 b = _mm_loadu_ps(depthToColor + 2 * i + 4);
+				__m128 x = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), half);
+				__m128 y = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), half);
+
+				// unmappable depth comes back as -inf, fails the bounds check
+				__m128 inFrame = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmplt_ps(x, w)),
+											_mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmplt_ps(y, h)));
+				__m128i mask = _mm_and_si128(body, _mm_castps_si128(inFrame));
+
+				// px index, exact in float (< 2^24)
+				__m128 xi = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+				__m128 yi = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+				__m128i idx = _mm_and_si128(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(yi, w), xi)), mask);
+
+#ifdef OFXKINECT2USER_AVX2
+				__m128i px = _mm_mask_i32gather_epi32(_mm_setzero_si128(), (const int*)color, idx, mask, 4);
+#else
+				alignas(16) int j[4];
+				_mm_store_si128((__m128i*)j, idx);
+				__m128i px = _mm_setr_epi32(color[j[0]], color[j[1]], color[j[2]], color[j[3]]);
+#endif
+				_mm_storeu_si128((__m128i*)(out + i), _mm_and_si128(_mm_or_si128(px, alpha), mask));
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = 0;
+				if (bodyIdx[i] != bodyId) continue;
+				float x = depthToColor[2 * i] + 0.5f, y = depthToColor[2 * i + 1] + 0.5f;
+				if (!(x >= 0 && x < 1920 && y >= 0 && y < 1080)) continue;
+				out[i] = color[(int)y * 1920 + (int)x] | 0xFF000000;
+			}
+		}
+
+		// color res cutout row: body index looked up through color->depth coords for every color px
+		void maskCutoutRow(const float* colorToDepth, const unsigned char* bodyIdx, int bodyId,
+						   const uint32_t* color, uint32_t* out, int n) {
+			int i = 0;
+#ifdef OFXKINECT2USER_SSE2
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 w = _mm_set1_ps(512.f);
+			const __m128 h = _mm_set1_ps(424.f);
+			const __m128i alpha = _mm_set1_epi32(0xFF000000);
+			alignas(16) int j[4];
+
+			for (; i + 4 <= n; i += 4) {
+				__m128 a = _mm_loadu_ps(colorToDepth + 2 * i);
+				__m128 b = _mm_loadu_ps(colorToDepth + 2 * i + 4);
+				__m128 x = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), half);
+				__m128 y = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), half);
+				__m128 inFrame = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmplt_ps(x, w)),
+											_mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmplt_ps(y, h)));
+				int inMask = _mm_movemask_ps(inFrame);
+				if (!inMask) {
+					_mm_storeu_si128((__m128i*)(out + i), _mm_setzero_si128());
+					continue;
 				}
+
+				__m128 xi = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+				__m128 yi = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+				_mm_store_si128((__m128i*)j, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(yi, w), xi)));
+				__m128i mask = _mm_setr_epi32(
+					(inMask & 1) && bodyIdx[j[0]] == bodyId ? -1 : 0,
+					(inMask & 2) && bodyIdx[j[1]] == bodyId ? -1 : 0,
+					(inMask & 4) && bodyIdx[j[2]] == bodyId ? -1 : 0,
+					(inMask & 8) && bodyIdx[j[3]] == bodyId ? -1 : 0);
+
+				__m128i px = _mm_loadu_si128((const __m128i*)(color + i));
+				_mm_storeu_si128((__m128i*)(out + i), _mm_and_si128(_mm_or_si128(px, alpha), mask));
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = 0;
+				float x = colorToDepth[2 * i] + 0.5f, y = colorToDepth[2 * i + 1] + 0.5f;
+				if (!(x >= 0 && x < 512 && y >= 0 && y < 424)) continue;
+				if (bodyIdx[(int)y * 512 + (int)x] != bodyId) continue;
+				out[i] = color[i] | 0xFF000000;
 			}
-		} // end loop through body idx pixels
+		}
+
+	}
+
+	bool User::buildCutout(Kinect* kinect, bool colorRes) {
+
+		// get body id
+		if (_bodyPtr == nullptr) {
+			ofLogError("User::buildCutout") << "can't build cutout, no user / body!";
+			return false;
+		}
+		const int bodyId = _bodyPtr->bodyId;
+		if (bodyId < 0 || bodyId > 5) {
+			ofLogError("User::buildCutout") << "can't build cutout, invalid bodyId: " << bodyId;
+			return false;
+		}
+		if (kinect == nullptr) {
+			ofLogError("User::buildCutout") << "can't build cutout, kinect is null";
+			return false;
+		}
+		if (_coordMapperPtr == nullptr) {
+			ofLogError("User::buildCutout") << "can't build cutout, no coordinate mapper";
+			return false;
+		}
+
+		auto& depthPix = kinect->getDepthPixels();
+		auto& bodyIdxPix = kinect->getBodyIndexSource()->getPixels();
+		auto& colorPix = kinect->getColorSource()->getPixels();
+		if (!depthPix.size()) {
+			ofLogError("User::buildCutout") << "can't build cutout, no depth pixels read";
+			return false;
+		}
+		if (!bodyIdxPix.size()) {
+			ofLogError("User::buildCutout") << "can't build cutout, body index source not allocated";
+			return false;
+		}
+		if (!colorPix.size() || colorPix.getNumChannels() != 4) {
+			ofLogError("User::buildCutout") << "can't build cutout, no RGBA color pixels";
+			return false;
+		}
 
+		const unsigned char* bodyIdx = bodyIdxPix.getPixels();
+		const uint32_t* color = (const uint32_t*)colorPix.getPixels();
+
+		// output buffer is reused, only reallocated when switching resolution
+		const int outW = colorRes ? 1920 : 512;
+		const int outH = colorRes ? 1080 : 424;
+		if ((int)_cutoutPixels.getWidth() != outW || (int)_cutoutPixels.getHeight() != outH) {
+			_cutoutPixels.allocate(outW, outH, OF_IMAGE_COLOR_ALPHA);
+			_cutoutPixels.set(0);
+			_cutoutRoi = ofRectangle();
+		}
+		uint32_t* out = (uint32_t*)_cutoutPixels.getPixels();
+
+		// clear last frame's roi
+		for (int y = _cutoutRoi.y; y < _cutoutRoi.getBottom(); y++) {
+			memset(out + y * outW + (int)_cutoutRoi.x, 0, (int)_cutoutRoi.width * 4);
+		}
+		_cutoutRoi = ofRectangle();
+
+		// body bounding box in depth img
+		int x0 = 512, y0 = 424, x1 = -1, y1 = -1;
+		for (int y = 0; y < 424; y++) {
+			const unsigned char* row = bodyIdx + y * 512;
+			for (int x = skipBackground(row, 0, 512); x < 512; x = skipBackground(row, x + 1, 512)) {
+				if (row[x] != bodyId) continue;
+				if (x < x0) x0 = x;
+				if (x > x1) x1 = x;
+				if (y < y0) y0 = y;
+				y1 = y;
+			}
+		}
+		if (x1 < 0) return true; // body not in frame, cutout stays empty
+
+		// mapped once per frame on the kinect, shared by all users
+		auto& depthToColorCoords = kinect->getDepthToColorCoords();
+		if (depthToColorCoords.empty()) {
+			ofLogError("User::buildCutout") << "can't build cutout, can't map depth to color space";
+			return false;
+		}
+		const float* depthToColor = (const float*)depthToColorCoords.data();
+
+		if (!colorRes) {
+			_cutoutRoi.set(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+			for (int y = y0; y <= y1; y++) {
+				int i = y * 512 + x0;
+				gatherCutoutRow(depthToColor + 2 * i, bodyIdx + i, bodyId, color, out + i, x1 - x0 + 1);
+			}
+			return true;
+		}
+
+		// color res: roi is the body's depth px mapped to color space, padded by ~1 depth px
+		float cx0 = 1920, cy0 = 1080, cx1 = -1, cy1 = -1;
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				int i = y * 512 + x;
+				if (bodyIdx[i] != bodyId) continue;
+				const ofVec2f& c = depthToColorCoords[i];
+				if (!(c.x >= 0 && c.x < 1920 && c.y >= 0 && c.y < 1080)) continue;
+				cx0 = std::min(cx0, c.x); cx1 = std::max(cx1, c.x);
+				cy0 = std::min(cy0, c.y); cy1 = std::max(cy1, c.y);
+			}
+		}
+		if (cx1 < 0) return true; // nothing maps into the color frame
+
+		int rx0 = std::max(0, (int)cx0 - 4), ry0 = std::max(0, (int)cy0 - 4);
+		int rx1 = std::min(1919, (int)cx1 + 4), ry1 = std::min(1079, (int)cy1 + 4);
+		_cutoutRoi.set(rx0, ry0, rx1 - rx0 + 1, ry1 - ry0 + 1);
+
+		auto& colorToDepthCoords = kinect->getColorToDepthCoords();
+		if (colorToDepthCoords.empty()) {
+			ofLogError("User::buildCutout") << "can't build cutout, can't map color to depth space";
+			return false;
+		}
+		const float* colorToDepth = (const float*)colorToDepthCoords.data();
+
+		for (int y = ry0; y <= ry1; y++) {
+			int i = y * 1920 + rx0;
+			maskCutoutRow(colorToDepth + 2 * i, bodyIdx, bodyId, color + i, out + i, rx1 - rx0 + 1);
+		}
 		return true;
 	}
 
@@ -469,29 +652,7 @@ namespace ofxKinectForWindows2 {
 
 	ofMatrix4x4 User::reflectionMatrix(ofVec4f plane)
 	{
-		ofMatrix4x4 ref;
-
-		ref(0,0) = (1. - 2. * plane[0] * plane[0]);
-		ref(1,0) = (-2. * plane[0] * plane[1]);
-		ref(2,0) = (-2. * plane[0] * plane[2]);
-		ref(3,0) = (-2. * plane[3] * plane[0]);
-
-		ref(0,1) = (-2. * plane[1] * plane[0]);
-		ref(1,1) = (1. - 2. * plane[1] * plane[1]);
-		ref(2,1) = (-2. * plane[1] * plane[2]);
-		ref(3,1) = (-2. * plane[3] * plane[1]);
-
-		ref(0,2) = (-2. * plane[2] * plane[0]);
-		ref(1,2) = (-2. * plane[2] * plane[1]);
-		ref(2,2) = (1. - 2. * plane[2] * plane[2]);
-		ref(3,2) = (-2. * plane[3] * plane[2]);
-
-		ref(0,3) = 0.;
-		ref(1,3) = 0.;
-		ref(2,3) = 0.;
-		ref(3,3) = 1.;
-
-		return ref;
+		return toOf(core::reflectionMatrix(toCore(plane)));
 	}
 
 }
@@ -2,9 +2,14 @@
 #include "ofMain.h"
 #include "ofxKinectForWindows2.h"
 #include "Kinect.h"
+#include "CoreAdapters.h"
+#include "core/Skeleton.h"
+#include "core/Clock.h"
 
 namespace ofxKinectForWindows2 {
 
+	class UserCache;
+
 	class User : public ofNode {
 	public:
 		struct HandStates {
@@ -25,11 +30,17 @@ namespace ofxKinectForWindows2 {
 		typedef map<JointType, JointData> JointMap;
 		typedef const ofxKFW2::Data::Body kBody;
 
+		// everything setBody() resets, saved / restored by UserCache
+		struct State {
+			float startTime = 0;
+			JointMap joints, pJoints;
+			HandStates handStates, pHandStates;
+		};
+
 		User(ICoordinateMapper* coordinateMapperPtr = nullptr)
 			: _coordMapperPtr(coordinateMapperPtr) 
 		{
 			// for mesh generator:
-			_depthToColorCoords.resize(512 * 424); // depth size
 			_depthToCameraCoords.resize(512 * 412);
 
 			// make x reflection matrix
@@ -65,8 +76,24 @@ namespace ofxKinectForWindows2 {
 											  _bMirrorX = mirror; }
 		const bool getMirrorX() const	{ return _bMirrorX; }
 
+		// offline use (recordings, no sensor): drive the user clock from recorded timestamps
+		// and skip color space projection, which needs the coordinate mapper
+		void setClockTime(float seconds)	{ _clock.setTime(seconds); } // < 0 to go back to ofGetElapsedTimef()
+		core::Clock& getClock()				{ return _clock; }
+		const core::Clock& getClock() const	{ return _clock; }
+
+		// re-identification: with a cache set, setBody() hands a lost body's state to the cache
+		// and a new body that matches a recently lost one gets that state back (not new, same start time)
+		// autoRecall false leaves matching to the app (UserCache::recall() for all users at once)
+		void setReidCache(UserCache* cache, bool autoRecall = true) { _cache = cache; _bAutoRecall = autoRecall; }
+		State getState() const;
+		void restoreState(const State& state); // marks the user as not new
+		void setProject2d(bool project)		{ _bProject2d = project; }
+		const bool getProject2d() const		{ return _bProject2d; }
+
 		bool setBody(kBody* body);	// returns true if change to user
 		bool update(float lerp = 1., float inferLerp = 1.); // return false if _bodyPtr is nullptr / lerp is pct 0-1
+		static int update(const vector<User*>& users, float lerp = 1., float inferLerp = 1.); // all users in one pass, returns # updated
 
 		bool jointExists(JointType type, bool prev = false);
 		ofVec2f getJoint2dPos(JointType type, bool prev = false);
@@ -98,15 +125,29 @@ namespace ofxKinectForWindows2 {
 		void drawHandState(JointType hand);
 
 		bool buildMesh(Kinect* kinect, int step = 1, float facesMaxLength = 0.1);
+		bool buildMeshAdaptive(Kinect* kinect, int maxTriangles = 20000, float facesMaxLength = 0.1);
+		// distance-adaptive step: 16x16 px blocks of the depth img pick a power of 2 step (1-16)
+		// for roughly even world space density, scaled to fit maxTriangles
+		// vertices where a finer block meets a coarser one are snapped onto the coarse edge (no cracks)
+		const ofMesh& getMesh() const { return _userMesh; }
 		void drawMeshWireframe();
 		void drawMeshFaces();
 		// extracts body shape on color img from kinect
 		// uses color->world coords to generate mesh, transformed by worldScale & worldTranslate
 
+		bool buildCutout(Kinect* kinect, bool colorRes = false);
+		const ofPixels& getCutoutPixels() const { return _cutoutPixels; }
+		const ofRectangle& getCutoutRoi() const { return _cutoutRoi; }
+		// masks user's px out of the color frame on the cpu, RGBA with alpha 0 outside the body
+		// depth res: 512x424 px, color gathered through depth->color coords
+		// color res: 1920x1080 px, body index looked up through color->depth coords
+		// only the roi (user's bounding box, in depth or color px) is written, rest stays transparent
+		// the coordinate mappings are done once per frame on the kinect & shared by all users' cutouts & meshes
+
 		void clear();
 
-		kBody* getBodyPtr() { return _bodyPtr; };
-		float getUserTime() { return (_startTime > 0 ? ofGetElapsedTimef() - _startTime : 0); }
+		kBody* getBodyPtr() const { return _bodyPtr; };
+		float getUserTime() { return (hasBody() ? now() - _startTime : 0); }
 		float getUserStartTime() { return _startTime; }	// 0 if no body
 
 		ofMatrix4x4 reflectionMatrix(ofVec4f plane);
@@ -120,8 +161,13 @@ namespace ofxKinectForWindows2 {
 		bool _bMirrorX = false;
 
 		ofMatrix4x4 reflection;
+
+		bool prepareMesh(Kinect* kinect, const string& logTag); // checks sources, maps depth frame into _userMesh
 		
 		float _startTime = 0; // time when new user init'ed
+		core::Clock _clock = core::Clock(ofElapsedSeconds);
+		float now() const { return (float)_clock.now(); }
+		bool _bProject2d = true;
 
 		JointMap _joints; // joints positions in 2d & 3d
 		JointMap _pJoints; // previous frame
@@ -129,11 +175,20 @@ namespace ofxKinectForWindows2 {
 		HandStates _pHandStates; // previous frame
 
 		ofMesh _userMesh;
-		vector<ofVec2f> _depthToColorCoords;
 		vector<ofVec3f> _depthToCameraCoords;
 
+		ofPixels _cutoutPixels;
+		ofRectangle _cutoutRoi;
+
+		bool beginUpdate(float lerp, float inferLerp, core::SkeletonUpdate& update); // joints into the core skeleton
+		void endUpdate(); // & back
+		core::Joints _skeleton, _skeletonPrev;
+
 		bool _bUserChanged = false;
 
+		UserCache* _cache = nullptr;
+		bool _bAutoRecall = true;
+
 	private:
 
 		ofMatrix4x4 reflectionX;
@@ -0,0 +1,184 @@
+#include "UserCache.h"
+
+namespace ofxKinectForWindows2 {
+
+	namespace {
+
+		// bone pairs for the length signature, symmetric bones averaged left/right
+		const JointType kBones[][2] = {
+			{ JointType_SpineBase, JointType_SpineShoulder },		// torso
+			{ JointType_SpineShoulder, JointType_Head },			// neck
+			{ JointType_ShoulderLeft, JointType_ShoulderRight },	// shoulder width
+			{ JointType_HipLeft, JointType_HipRight },				// hip width
+			{ JointType_ShoulderLeft, JointType_ElbowLeft },		{ JointType_ShoulderRight, JointType_ElbowRight },
+			{ JointType_ElbowLeft, JointType_WristLeft },			{ JointType_ElbowRight, JointType_WristRight },
+			{ JointType_HipLeft, JointType_KneeLeft },				{ JointType_HipRight, JointType_KneeRight },
+			{ JointType_KneeLeft, JointType_AnkleLeft },			{ JointType_KneeRight, JointType_AnkleRight },
+		};
+		const int kBoneSlot[] = { 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 7, 7 };
+		const int kNumBonePairs = sizeof(kBoneSlot) / sizeof(kBoneSlot[0]);
+
+		// joint access for both sources: the sdk body & the user's joint map (raw positions)
+		bool jointPos(const map<JointType, Data::Joint>& joints, JointType type, ofVec3f& pos) {
+			auto it = joints.find(type);
+			if (it == joints.end() || it->second.getTrackingState() != TrackingState_Tracked) return false;
+			pos = it->second.getPosition();
+			return true;
+		}
+		bool jointPos(const User::JointMap& joints, JointType type, ofVec3f& pos) {
+			auto it = joints.find(type);
+			if (it == joints.end() || it->second.state != TrackingState_Tracked) return false;
+			pos = it->second.pos3dRaw;
+			return true;
+		}
+	}
+
+	void UserCache::update(Kinect* kinect) {
+		if (!kinect || !kinect->getBodySource()) return;
+		setFloorClipPlane(kinect->getFloorClipPlane());
+	}
+
+	template<typename Joints>
+	UserCache::Candidate UserCache::describe(const Joints& joints) const {
+
+		Candidate c;
+
+		ofVec3f spine;
+		if (jointPos(joints, JointType_SpineBase, spine)) {
+			core::Vec3 p = _floor.closestPtOnPlane(toCore(spine));
+			c.floorPos = ofVec2f(p.x, p.z);
+			c.hasFloorPos = true;
+		}
+
+		// bone lengths, -1 if a joint isn't tracked
+		float sum[kNumBones] = {}; int n[kNumBones] = {};
+		for (int b = 0; b < kNumBonePairs; b++) {
+			ofVec3f a, e;
+			if (!jointPos(joints, kBones[b][0], a) || !jointPos(joints, kBones[b][1], e)) continue;
+			sum[kBoneSlot[b]] += a.distance(e);
+			n[kBoneSlot[b]]++;
+		}
+		for (int i = 0; i < kNumBones; i++) c.bones[i] = n[i] ? sum[i] / n[i] : -1;
+
+		return c;
+	}
+
+	void UserCache::expire(float now) {
+		_lost.erase(std::remove_if(_lost.begin(), _lost.end(), [&](const Lost& lost) {
+			return now - lost.lostTime > _window || now < lost.lostTime; // clock jumped back: drop
+		}), _lost.end());
+	}
+
+	void UserCache::remember(const User& user) {
+
+		kBody* body = user.getBodyPtr();
+		if (!body) return;
+
+		float now = (float)user.getClock().now();
+		expire(now);
+
+		User::State state = user.getState();
+		if (state.joints.empty()) return; // never updated, nothing worth keeping
+
+		Lost lost;
+		lost.trackingId = body->trackingId;
+		lost.lostTime = now;
+		Candidate c = describe(state.joints);
+		lost.hasFloorPos = c.hasFloorPos;
+		lost.floorPos = c.floorPos;
+		memcpy(lost.bones, c.bones, sizeof(lost.bones));
+		lost.state = std::move(state);
+
+		// a trackingId is one person, keep the latest
+		_lost.erase(std::remove_if(_lost.begin(), _lost.end(), [&](const Lost& l) {
+			return l.trackingId && l.trackingId == lost.trackingId;
+		}), _lost.end());
+		if (_lost.size() >= _maxLost) _lost.erase(_lost.begin()); // oldest
+		_lost.push_back(std::move(lost));
+	}
+
+	bool UserCache::cost(const Lost& lost, UINT64 trackingId, const Candidate& c, float& cost) const {
+
+		if (trackingId && trackingId == lost.trackingId) {
+			cost = 0;
+			return true;
+		}
+
+		// position is required, bone lengths are compared where both sides have them
+		if (!lost.hasFloorPos || !c.hasFloorPos) return false;
+		float floorDist = lost.floorPos.distance(c.floorPos);
+		if (floorDist > _maxFloorDist) return false;
+
+		float boneDiff = 0; int n = 0;
+		for (int i = 0; i < kNumBones; i++) {
+			if (lost.bones[i] < 0 || c.bones[i] < 0) continue;
+			boneDiff += fabs(lost.bones[i] - c.bones[i]);
+			n++;
+		}
+		if (n) {
+			boneDiff /= n;
+			if (boneDiff > _maxBoneDiff) return false;
+		}
+
+		// normalized, anything > 0 ranks below a trackingId match
+		cost = 1e-3f + floorDist / _maxFloorDist + (n ? boneDiff / _maxBoneDiff : 1.f);
+		return true;
+	}
+
+	bool UserCache::recall(User& user) {
+		return recall(vector<User*>{ &user }) > 0;
+	}
+
+	int UserCache::recall(const vector<User*>& users) {
+
+		for (auto* user : users) {
+			if (user) { expire((float)user->getClock().now()); break; }
+		}
+		if (_lost.empty()) return 0;
+
+		struct Pair {
+			float cost;
+			size_t user, lost;
+			bool operator<(const Pair& p) const { return cost < p.cost; }
+		};
+		vector<Pair> pairs;
+
+		for (size_t u = 0; u < users.size(); u++) {
+			User* user = users[u];
+			if (!user || !user->hasBody() || !user->isNew()) continue;
+
+			kBody* body = user->getBodyPtr();
+			Candidate c = describe(body->joints);
+			for (size_t l = 0; l < _lost.size(); l++) {
+				float cst;
+				if (cost(_lost[l], body->trackingId, c, cst)) pairs.push_back({ cst, u, l });
+			}
+		}
+		if (pairs.empty()) return 0;
+
+		// greedy assignment, cheapest pairs first
+		std::sort(pairs.begin(), pairs.end());
+		vector<bool> userDone(users.size()), lostDone(_lost.size());
+		int restored = 0;
+		for (auto& p : pairs) {
+			if (userDone[p.user] || lostDone[p.lost]) continue;
+			userDone[p.user] = lostDone[p.lost] = true;
+			users[p.user]->restoreState(_lost[p.lost].state);
+			ofLogVerbose("UserCache") << "restored user lost " << users[p.user]->getClock().now() - _lost[p.lost].lostTime << " s ago, cost " << p.cost;
+			restored++;
+		}
+
+		// restored entries are used up
+		size_t k = 0;
+		for (size_t l = 0; l < _lost.size(); l++) {
+			if (!lostDone[l]) {
+				if (k != l) _lost[k] = std::move(_lost[l]);
+				k++;
+			}
+		}
+		_lost.resize(k);
+
+		return restored;
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "Kinect.h"
+#include "User.h"
+#include "core/Floor.h"
+
+namespace ofxKinectForWindows2 {
+
+	// re-identification of users across short tracking dropouts
+	// lost users are kept for a window of seconds (user clock), a new body is matched against them by
+	// trackingId (same id = same person), else floor position (x,z) + bone length signature
+	// a match hands the old User::State back: start time, joint history & smoothing carry on, isNew() is false
+	//
+	// usage: user.setReidCache(&cache) for every user, cache.update(&kinect) once per frame (floor plane)
+
+	class UserCache {
+	public:
+
+		static const int kNumBones = 8; // torso, neck, shoulders, hips, upper arms, forearms, thighs, shins
+
+		void update(Kinect* kinect);				// floor plane for floor positions
+		void setFloorClipPlane(Vector4 plane)		{ _floor.setPlane(toCore(plane)); }
+
+		void setWindow(float seconds)				{ _window = seconds; }
+		void setMaxFloorDistance(float meters)		{ _maxFloorDist = meters; }
+		void setMaxBoneDifference(float meters)		{ _maxBoneDiff = meters; }	// mean abs bone length difference
+		float getWindow() const						{ return _window; }
+
+		void remember(const User& user);			// snapshot of a user losing its body
+		bool recall(User& user);					// restores user if its new body matches a lost one
+		int recall(const vector<User*>& users);		// all new users at once, greedy by cost, returns # restored
+		void clear()								{ _lost.clear(); }
+		size_t size() const							{ return _lost.size(); }
+
+	protected:
+
+		struct Lost {
+			User::State state;
+			UINT64 trackingId = 0;
+			float lostTime = 0;
+			bool hasFloorPos = false;
+			ofVec2f floorPos;
+			float bones[kNumBones];
+		};
+
+		struct Candidate {
+			bool hasFloorPos = false;
+			ofVec2f floorPos;
+			float bones[kNumBones];
+		};
+
+		void expire(float now);
+		bool cost(const Lost& lost, UINT64 trackingId, const Candidate& candidate, float& cost) const;
+		template<typename Joints> Candidate describe(const Joints& joints) const;
+
+		vector<Lost> _lost;
+		core::Floor _floor;
+		float _window = 2;
+		float _maxFloorDist = 0.5;
+		float _maxBoneDiff = 0.04;
+		size_t _maxLost = 32;
+	};
+
+}
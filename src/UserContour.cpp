@@ -0,0 +1,272 @@
+#include "UserContour.h"
+#include "core/Simd.h"
+
+namespace ofxKinectForWindows2 {
+
+	namespace {
+		// marching squares cells are corner-aligned on body idx px and padded by 1 on every side,
+		// cell (cx,cy) spans px cx..cx+1, cy..cy+1 for cx in [-1,512], cy in [-1,424]
+		// each cell owns its top (2*cell) and left (2*cell+1) edge
+		const int kCellCols = 512 + 2;
+		const int kCellRows = 424 + 2;
+	}
+
+	UserContour::UserContour() {
+		_next.assign(2 * kCellCols * kCellRows, -1);
+		for (auto& b : _bounds) b = { 1, 1, 0, 0 };
+	}
+
+	const vector<ofPolyline>& UserContour::getContours(int bodyId) const {
+		if (bodyId < 0 || bodyId > 5) return _empty;
+		return _contours[bodyId];
+	}
+
+	bool UserContour::update(Kinect* kinect, int bodyId) {
+
+		for (auto& contours : _contours) contours.clear();
+
+		if (bodyId < -1 || bodyId > 5) {
+			ofLogError("UserContour::update") << "can't update, invalid bodyId: " << bodyId;
+			return false;
+		}
+		if (kinect == nullptr) {
+			ofLogError("UserContour::update") << "can't update, kinect is null";
+			return false;
+		}
+		ICoordinateMapper* mapper = kinect->getCoordinateMapper();
+		if (_space != DEPTH_SPACE && mapper == nullptr) {
+			ofLogError("UserContour::update") << "can't update, no coordinate mapper";
+			return false;
+		}
+
+		auto& bodyIdxPix = kinect->getBodyIndexSource()->getPixels();
+		if (!bodyIdxPix.size()) {
+			ofLogError("UserContour::update") << "can't update, body index source not allocated";
+			return false;
+		}
+		const UINT16* depth = nullptr;
+		if (_space != DEPTH_SPACE) {
+			auto& depthPix = kinect->getDepthPixels();
+			if (!depthPix.size()) {
+				ofLogError("UserContour::update") << "can't update, no depth pixels read";
+				return false;
+			}
+			depth = (const UINT16*)depthPix.getPixels();
+		}
+
+		const unsigned char* bodyIdx = bodyIdxPix.getPixels();
+		scanBounds(bodyIdx);
+
+		for (int b = 0; b < 6; b++) {
+			if (bodyId >= 0 && b != bodyId) continue;
+			traceBody(bodyIdx, b);
+			if (_space != DEPTH_SPACE) mapBody(depth, bodyIdx, b, mapper);
+		}
+		return true;
+	}
+
+	void UserContour::scanBounds(const unsigned char* bodyIdx) {
+
+		for (auto& b : _bounds) b = { 512, 424, -1, -1 };
+
+		for (int y = 0; y < 424; y++) {
+			const unsigned char* row = bodyIdx + y * 512;
+			for (int x = skipBackground(row, 0, 512); x < 512; x = skipBackground(row, x + 1, 512)) {
+				int val = row[x];
+				if (val > 5) continue;
+				Bounds& b = _bounds[val];
+				if (x < b.x0) b.x0 = x;
+				if (x > b.x1) b.x1 = x;
+				if (y < b.y0) b.y0 = y;
+				b.y1 = y;
+			}
+		}
+	}
+
+	ofVec2f UserContour::edgePos(int edge) const {
+		int cell = edge >> 1;
+		float cx = cell % kCellCols - 1;
+		float cy = cell / kCellCols - 1;
+		if (edge & 1) return ofVec2f(cx, cy + 0.5); // left edge
+		return ofVec2f(cx + 0.5, cy); // top edge
+	}
+
+	void UserContour::traceBody(const unsigned char* bodyIdx, int bodyId) {
+
+		const Bounds& bb = _bounds[bodyId];
+		if (bb.x0 > bb.x1) return; // body not in frame
+
+		auto in = [&](int x, int y) -> int {
+			return (x >= 0 && y >= 0 && x < 512 && y < 424 && bodyIdx[y * 512 + x] == bodyId) ? 1 : 0;
+		};
+
+		// link edges cell by cell, oriented with the body on the right hand side
+		//
+		//  TL(8)__T__TR(4)
+		//    |         |
+		//    L         R
+		//    |____B____|
+		//  BL(1)     BR(2)
+		//
+		// saddles (5, 10) are kept apart, i.e. 4-connected bodies
+		//
+		_edges.clear();
+		for (int cy = bb.y0 - 1; cy <= bb.y1; cy++) {
+			int tr = in(bb.x0 - 1, cy);
+			int br = in(bb.x0 - 1, cy + 1);
+			for (int cx = bb.x0 - 1; cx <= bb.x1; cx++) {
+				int tl = tr, bl = br;
+				tr = in(cx + 1, cy);
+				br = in(cx + 1, cy + 1);
+
+				int c = (tl << 3) | (tr << 2) | (br << 1) | bl;
+				if (c == 0 || c == 15) continue;
+
+				int cell = (cy + 1) * kCellCols + (cx + 1);
+				int T = 2 * cell;
+				int L = 2 * cell + 1;
+				int B = 2 * (cell + kCellCols);
+				int R = 2 * (cell + 1) + 1;
+
+				switch (c) {
+					case 1:  link(L, B); break;
+					case 2:  link(B, R); break;
+					case 3:  link(L, R); break;
+					case 4:  link(R, T); break;
+					case 5:  link(L, B); link(R, T); break;
+					case 6:  link(B, T); break;
+					case 7:  link(L, T); break;
+					case 8:  link(T, L); break;
+					case 9:  link(T, B); break;
+					case 10: link(T, L); link(B, R); break;
+					case 11: link(T, R); break;
+					case 12: link(R, L); break;
+					case 13: link(R, B); break;
+					case 14: link(B, L); break;
+				}
+			}
+		}
+
+		// follow the links into closed loops, resetting _next as we go
+		auto& contours = _contours[bodyId];
+		for (int start : _edges) {
+			if (_next[start] < 0) continue; // already on a traced loop
+
+			_pts.clear();
+			int edge = start;
+			do {
+				ofVec2f p = edgePos(edge);
+				size_t n = _pts.size();
+				if (n >= 2) {
+					// drop collinear midpoints, runs along rows / diagonals collapse to their ends
+					ofVec2f d0 = _pts[n - 1] - _pts[n - 2];
+					ofVec2f d1 = p - _pts[n - 1];
+					if (d0.x * d1.y - d0.y * d1.x == 0) _pts[n - 1] = p;
+					else _pts.push_back(p);
+				}
+				else _pts.push_back(p);
+
+				int next = _next[edge];
+				_next[edge] = -1;
+				edge = next;
+			} while (edge >= 0 && edge != start);
+
+			// same across the seam where the loop closes
+			auto collinear = [](const ofVec2f& a, const ofVec2f& b, const ofVec2f& c) {
+				return (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x) == 0;
+			};
+			if (_pts.size() > 3 && collinear(_pts[_pts.size() - 2], _pts.back(), _pts[0])) _pts.pop_back();
+			if (_pts.size() > 3 && collinear(_pts.back(), _pts[0], _pts[1])) _pts.erase(_pts.begin());
+
+			if ((int)_pts.size() < _minPoints) continue;
+
+			if (!_bHoles) {
+				// outer contours have positive area (clockwise with y down), holes negative
+				float area = 0;
+				for (size_t i = 0, j = _pts.size() - 1; i < _pts.size(); j = i++) {
+					area += _pts[j].x * _pts[i].y - _pts[i].x * _pts[j].y;
+				}
+				if (area < 0) continue;
+			}
+
+			contours.push_back(ofPolyline());
+			ofPolyline& poly = contours.back();
+			for (auto& p : _pts) poly.addVertex(p.x, p.y);
+			poly.setClosed(true);
+			if (_simplify > 0) poly.simplify(_simplify);
+		}
+	}
+
+	void UserContour::mapBody(const UINT16* depth, const unsigned char* bodyIdx, int bodyId, ICoordinateMapper* mapper) {
+
+		auto& contours = _contours[bodyId];
+		if (contours.empty()) return;
+
+		// gather all vertices of the body into one mapper call
+		_mapPts.clear();
+		_mapDepths.clear();
+		UINT16 lastDepth = 0;
+		for (auto& poly : contours) {
+			for (auto& v : poly.getVertices()) {
+				// vertices sit on edge midpoints between a body px and a background px,
+				// sample depth from the body side
+				int x0 = (int)floorf(v.x), y0 = (int)floorf(v.y);
+				int x1 = x0, y1 = y0;
+				if (v.x != x0) x1++;
+				else y1++;
+				int i0 = y0 * 512 + x0, i1 = y1 * 512 + x1;
+				bool in0 = x0 >= 0 && y0 >= 0 && x0 < 512 && y0 < 424 && bodyIdx[i0] == bodyId;
+				UINT16 d = in0 ? depth[i0] : (x1 < 512 && y1 < 424 ? depth[i1] : 0);
+				if (d == 0) d = lastDepth; // depth hole, reuse neighbouring vertex
+				lastDepth = d;
+
+				DepthSpacePoint dp = { v.x, v.y };
+				_mapPts.push_back(dp);
+				_mapDepths.push_back(d);
+			}
+		}
+
+		UINT n = (UINT)_mapPts.size();
+		size_t k = 0;
+		if (_space == COLOR_SPACE) {
+			_colorPts.resize(n);
+			mapper->MapDepthPointsToColorSpace(n, _mapPts.data(), n, _mapDepths.data(), n, _colorPts.data());
+			for (auto& poly : contours) {
+				for (auto& v : poly.getVertices()) {
+					v.x = _colorPts[k].X;
+					v.y = _colorPts[k].Y;
+					k++;
+				}
+			}
+		}
+		else if (_space == CAMERA_SPACE) {
+			_cameraPts.resize(n);
+			mapper->MapDepthPointsToCameraSpace(n, _mapPts.data(), n, _mapDepths.data(), n, _cameraPts.data());
+			for (auto& poly : contours) {
+				for (auto& v : poly.getVertices()) {
+					v.x = _cameraPts[k].X;
+					v.y = _cameraPts[k].Y;
+					v.z = _cameraPts[k].Z;
+					k++;
+				}
+			}
+		}
+	}
+
+	bool UserContour::inside(float x, float y, int bodyId) const {
+		// even-odd across outer contours and holes
+		bool in = false;
+		for (auto& poly : getContours(bodyId)) {
+			if (poly.inside(x, y)) in = !in;
+		}
+		return in;
+	}
+
+	void UserContour::draw(int bodyId) {
+		for (int b = 0; b < 6; b++) {
+			if (bodyId >= 0 && b != bodyId) continue;
+			for (auto& poly : _contours[b]) poly.draw();
+		}
+	}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "Kinect.h"
+
+namespace ofxKinectForWindows2 {
+
+	// user silhouette outlines from the body index frame
+	// marching squares over each body's bounding box in the 512x424 body index img,
+	// optional simplification, only the contour vertices are sent through the coordinate mapper
+	// cheap alternative to User::buildMesh() when only the outline is needed (effects, hit-testing)
+
+	class UserContour {
+	public:
+
+		enum Space {
+			DEPTH_SPACE,	// body index / depth px coords
+			COLOR_SPACE,	// 1920x1080 color px coords
+			CAMERA_SPACE	// kinect camera space, meters
+		};
+
+		UserContour();
+
+		void setSpace(Space space)				{ _space = space; }
+		void setSimplify(float tolerance)		{ _simplify = tolerance; }	// depth px, 0 = off
+		void setMinPoints(int minPoints)		{ _minPoints = minPoints; }	// drops specks
+		void setIncludeHoles(bool holes)		{ _bHoles = holes; }
+		Space getSpace() const					{ return _space; }
+
+		bool update(Kinect* kinect, int bodyId = -1); // -1 for all bodies
+
+		const vector<ofPolyline>& getContours(int bodyId) const; // outer contours are clockwise in depth/color img
+		bool hasContours(int bodyId) const		{ return getContours(bodyId).size() > 0; }
+		bool inside(float x, float y, int bodyId) const; // hit test in output space (depth or color)
+
+		void draw(int bodyId = -1);
+
+	protected:
+
+		struct Bounds {
+			int x0, y0, x1, y1; // inclusive, x0 > x1 if empty
+		};
+
+		void scanBounds(const unsigned char* bodyIdx);
+		void traceBody(const unsigned char* bodyIdx, int bodyId);
+		void mapBody(const UINT16* depth, const unsigned char* bodyIdx, int bodyId, ICoordinateMapper* mapper);
+
+		void link(int from, int to) { _next[from] = to; _edges.push_back(from); }
+		ofVec2f edgePos(int edge) const;
+
+		Space _space = DEPTH_SPACE;
+		float _simplify = 0;
+		int _minPoints = 8;
+		bool _bHoles = true;
+
+		Bounds _bounds[6];
+		vector<ofPolyline> _contours[6];
+		vector<ofPolyline> _empty;
+
+		vector<int> _next;			// marching squares edge -> next edge on the contour, -1 if none
+		vector<int> _edges;			// edges linked this pass
+		vector<ofVec2f> _pts;		// contour being traced
+
+		vector<DepthSpacePoint> _mapPts;	// contour vertices for the coordinate mapper
+		vector<UINT16> _mapDepths;
+		vector<ColorSpacePoint> _colorPts;
+		vector<CameraSpacePoint> _cameraPts;
+	};
+
+}
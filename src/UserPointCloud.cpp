@@ -0,0 +1,217 @@
+#include "UserPointCloud.h"
+#include "core/Simd.h"
+#include <cfloat>
+
+namespace ofxKinectForWindows2 {
+
+	UserPointCloud::UserPointCloud() {
+		for (int b = 0; b < 6; b++) {
+			_meshes[b].setMode(OF_PRIMITIVE_POINTS);
+			_bTransform[b] = false;
+			_usedVoxelSize[b] = 0;
+		}
+	}
+
+	void UserPointCloud::setTransform(int bodyId, const ofMatrix4x4& transform) {
+		if (bodyId < 0 || bodyId > 5) return;
+		_transforms[bodyId] = transform;
+		_bTransform[bodyId] = !transform.isIdentity();
+	}
+
+	void UserPointCloud::setTransform(User& user) {
+		kBody* body = user.getBodyPtr();
+		if (!body) return;
+		ofMatrix4x4 m = user.getGlobalTransformMatrix();
+		if (user.getMirrorX()) m = m * user.getReflection(); // like the joints: p * node * reflection
+		setTransform(body->bodyId, m);
+	}
+
+	void UserPointCloud::clearTransforms() {
+		for (int b = 0; b < 6; b++) {
+			_transforms[b] = ofMatrix4x4();
+			_bTransform[b] = false;
+		}
+	}
+
+	const ofMesh& UserPointCloud::getMesh(int bodyId) const {
+		if (bodyId < 0 || bodyId > 5) return _empty;
+		return _meshes[bodyId];
+	}
+
+	bool UserPointCloud::update(Kinect* kinect, int bodyId) {
+
+		// keep buffers, only sizes change frame to frame
+		for (int b = 0; b < 6; b++) {
+			_meshes[b].getVertices().clear();
+			_meshes[b].getColors().clear();
+			_points[b].clear();
+			_pixels[b].clear();
+			_colors[b].clear();
+			_usedVoxelSize[b] = 0;
+		}
+
+		if (bodyId < -1 || bodyId > 5) {
+			ofLogError("UserPointCloud::update") << "can't update, invalid bodyId: " << bodyId;
+			return false;
+		}
+		if (kinect == nullptr) {
+			ofLogError("UserPointCloud::update") << "can't update, kinect is null";
+			return false;
+		}
+		ICoordinateMapper* mapper = kinect->getCoordinateMapper();
+		if (mapper == nullptr) {
+			ofLogError("UserPointCloud::update") << "can't update, no coordinate mapper";
+			return false;
+		}
+		auto& bodyIdxPix = kinect->getBodyIndexSource()->getPixels();
+		if (!bodyIdxPix.size()) {
+			ofLogError("UserPointCloud::update") << "can't update, body index source not allocated";
+			return false;
+		}
+		auto& depthPix = kinect->getDepthPixels();
+		if (!depthPix.size()) {
+			ofLogError("UserPointCloud::update") << "can't update, no depth pixels read";
+			return false;
+		}
+		if (!updateCameraTable(mapper)) {
+			ofLogWarning("UserPointCloud::update") << "can't update, depth->camera table not available yet";
+			return false;
+		}
+
+		const unsigned char* bodyIdx = bodyIdxPix.getPixels();
+		const UINT16* depth = (const UINT16*)depthPix.getPixels();
+		const ofVec2f* table = _cameraTable.data();
+
+		for (int b = 0; b < 6; b++) {
+			_min[b] = ofVec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+			_max[b] = ofVec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+
+		// all users' body px in one pass, camera space & bounds
+		for (int y = 0; y < 424; y++) {
+			const unsigned char* row = bodyIdx + y * 512;
+			for (int x = skipBackground(row, 0, 512); x < 512; x = skipBackground(row, x + 1, 512)) {
+				int val = row[x];
+				if (val > 5 || (bodyId >= 0 && val != bodyId)) continue;
+				int i = y * 512 + x;
+				if (!depth[i]) continue;
+
+				float z = depth[i] * 0.001f;
+				ofVec3f p(table[i].x * z, table[i].y * z, z);
+				_points[val].push_back(p);
+				_pixels[val].push_back(i);
+
+				ofVec3f& mn = _min[val];
+				ofVec3f& mx = _max[val];
+				if (p.x < mn.x) mn.x = p.x;
+				if (p.y < mn.y) mn.y = p.y;
+				if (p.z < mn.z) mn.z = p.z;
+				if (p.x > mx.x) mx.x = p.x;
+				if (p.y > mx.y) mx.y = p.y;
+				if (p.z > mx.z) mx.z = p.z;
+			}
+		}
+
+		if (_bColors) mapColors(kinect, depth);
+
+		for (int b = 0; b < 6; b++) {
+			if (_points[b].empty()) continue;
+
+			float voxelSize = _voxelSize;
+			const uint32_t* pointColors = _colors[b].size() == _points[b].size() ? _colors[b].data() : nullptr;
+			int n = _grid.downsample((const core::Vec3*)_points[b].data(), pointColors, _points[b].size(),
+									 toCore(_min[b]), toCore(_max[b]), voxelSize, _maxPoints);
+			_usedVoxelSize[b] = voxelSize;
+			const vector<core::Voxel>& voxels = _grid.getVoxels();
+
+			auto& verts = _meshes[b].getVertices();
+			auto& colors = _meshes[b].getColors();
+			const bool hasColors = pointColors != nullptr;
+			verts.resize(n);
+			if (hasColors) colors.resize(n);
+
+			for (int k = 0; k < n; k++) {
+				const core::Voxel& v = voxels[k];
+				ofVec3f p(v.x / v.n, v.y / v.n, v.z / v.n);
+				verts[k] = _bTransform[b] ? p * _transforms[b] : p;
+				if (hasColors) {
+					colors[k] = v.nColor ? ofFloatColor(v.r / (255.f * v.nColor), v.g / (255.f * v.nColor), v.b / (255.f * v.nColor))
+										 : ofFloatColor(1, 1, 1);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool UserPointCloud::updateCameraTable(ICoordinateMapper* mapper) {
+
+		if (_cameraTable.size()) return true;
+
+		UINT32 count = 0;
+		PointF* table = nullptr;
+		HRESULT hr = mapper->GetDepthFrameToCameraSpaceTable(&count, &table);
+		bool ok = SUCCEEDED(hr) && table && count == 512 * 424
+			&& (table[0].X != 0 || table[0].Y != 0); // zeros until the sensor has sent its intrinsics
+		if (ok) {
+			_cameraTable.resize(count);
+			for (UINT32 i = 0; i < count; i++) _cameraTable[i] = ofVec2f(table[i].X, table[i].Y);
+		}
+		if (table) CoTaskMemFree(table);
+		return ok;
+	}
+
+	void UserPointCloud::mapColors(Kinect* kinect, const UINT16* depth) {
+
+		auto& colorPix = kinect->getColorPixels();
+		const int channels = colorPix.getNumChannels();
+		if (!colorPix.size() || channels < 3) return; // points stay uncolored
+
+		// one mapper call for everyone
+		size_t total = 0;
+		for (int b = 0; b < 6; b++) total += _pixels[b].size();
+		if (!total) return;
+		_mapPts.resize(total);
+		_mapDepths.resize(total);
+		_colorPts.resize(total);
+
+		size_t k = 0;
+		for (int b = 0; b < 6; b++) {
+			for (int i : _pixels[b]) {
+				_mapPts[k].X = (float)(i % 512);
+				_mapPts[k].Y = (float)(i / 512);
+				_mapDepths[k] = depth[i];
+				k++;
+			}
+		}
+		ICoordinateMapper* mapper = kinect->getCoordinateMapper();
+		if (FAILED(mapper->MapDepthPointsToColorSpace((UINT)total, _mapPts.data(), (UINT)total, _mapDepths.data(), (UINT)total, _colorPts.data()))) {
+			ofLogWarning("UserPointCloud::mapColors") << "can't map depth px to color space, points stay uncolored";
+			return;
+		}
+
+		const unsigned char* color = colorPix.getPixels();
+		k = 0;
+		for (int b = 0; b < 6; b++) {
+			_colors[b].resize(_pixels[b].size());
+			for (auto& c : _colors[b]) {
+				const ColorSpacePoint& cp = _colorPts[k++];
+				if (!(cp.X >= 0 && cp.Y >= 0 && cp.X < 1919.5f && cp.Y < 1079.5f)) { // also fails on -inf (no depth)
+					c = 0;
+					continue;
+				}
+				int cx = (int)(cp.X + 0.5f), cy = (int)(cp.Y + 0.5f);
+				const unsigned char* px = color + (cy * 1920 + cx) * channels;
+				c = px[0] | (px[1] << 8) | (px[2] << 16) | 0xFF000000;
+			}
+		}
+	}
+
+	void UserPointCloud::draw(int bodyId) {
+		for (int b = 0; b < 6; b++) {
+			if (bodyId >= 0 && b != bodyId) continue;
+			_meshes[b].draw();
+		}
+	}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "ofMain.h"
+#include "ofxKinectForWindows2.h"
+#include "Kinect.h"
+#include "User.h"
+#include "core/VoxelGrid.h"
+
+namespace ofxKinectForWindows2 {
+
+	// voxel downsampled point clouds of all users, one pass over the body index frame
+	// body px go to camera space through the sensor's depth->camera table (only body px, not the whole frame),
+	// then into a dense voxel grid over each user's bounding box (core::VoxelGrid)
+	// every voxel becomes one point: centroid + average color (depth->color mapped, optional)
+	// maxPoints bounds the output per user, voxels grow when a user would have more (strided if still over)
+
+	class UserPointCloud {
+	public:
+
+		UserPointCloud();
+
+		void setVoxelSize(float meters)			{ _voxelSize = meters; }
+		void setMaxPoints(int maxPoints)		{ _maxPoints = maxPoints; }	// per user, 0 = no limit
+		void setColors(bool colors)				{ _bColors = colors; }		// needs the color source
+
+		// points are in kinect camera space unless a user has a transform
+		void setTransform(int bodyId, const ofMatrix4x4& transform);
+		void setTransform(User& user);	// user node transform (+ mirroring), same space as the joints' pos3d
+		void clearTransforms();
+
+		bool update(Kinect* kinect, int bodyId = -1); // -1 for all bodies
+
+		const ofMesh& getMesh(int bodyId) const;	// OF_PRIMITIVE_POINTS, vertices + colors
+		size_t getNumPoints(int bodyId) const		{ return getMesh(bodyId).getVertices().size(); }
+		float getVoxelSize(int bodyId) const		{ return bodyId >= 0 && bodyId < 6 ? _usedVoxelSize[bodyId] : 0; } // after maxPoints
+
+		void draw(int bodyId = -1);
+
+	protected:
+
+		bool updateCameraTable(ICoordinateMapper* mapper);
+		void mapColors(Kinect* kinect, const UINT16* depth);
+
+		float _voxelSize = 0.02;
+		int _maxPoints = 4000;
+		bool _bColors = true;
+
+		ofMatrix4x4 _transforms[6];
+		bool _bTransform[6];
+
+		ofMesh _meshes[6];
+		ofMesh _empty;
+		float _usedVoxelSize[6];
+
+		vector<ofVec2f> _cameraTable;		// depth px -> camera x,y at 1 m depth
+
+		// body px this frame
+		vector<ofVec3f> _points[6];			// camera space
+		vector<int> _pixels[6];				// depth px index
+		vector<uint32_t> _colors[6];		// RGBA, alpha 0 = no color
+		ofVec3f _min[6], _max[6];
+
+		vector<DepthSpacePoint> _mapPts;	// all users' px for one coordinate mapper call
+		vector<UINT16> _mapDepths;
+		vector<ColorSpacePoint> _colorPts;
+
+		core::VoxelGrid _grid;
+	};
+
+}
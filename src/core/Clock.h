@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	// time source for users, seconds
+	// defaults to a steady clock started with the process, apps plug in their own
+	// (ofGetElapsedTimef() through CoreAdapters.h), offline runs set the time by hand
+	class Clock {
+	public:
+
+		typedef double(*Source)();
+
+		Clock(Source source = steadySeconds) : _source(source) {}
+
+		void setSource(Source source)	{ _source = source ? source : steadySeconds; }
+		void setTime(double seconds)	{ _time = seconds; } // manual time, < 0 to go back to the source
+		bool isManual() const			{ return _time >= 0; }
+
+		double now() const { return _time >= 0 ? _time : _source(); }
+
+		static double steadySeconds() {
+			static const auto start = std::chrono::steady_clock::now();
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+	protected:
+
+		Source _source;
+		double _time = -1;
+	};
+
+}
+}
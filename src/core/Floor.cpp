@@ -0,0 +1,36 @@
+#include "Floor.h"
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	void Floor::setPlane(const Vec4& floorClipPlane) {
+		_transform = transformFromPlane(floorClipPlane);
+		_inverse = _transform.inverse();
+	}
+
+	Mat4 Floor::transformFromPlane(const Vec4& fcp) {
+
+		Vec3 normal(fcp.x, fcp.y, fcp.z);
+		float distance = fcp.w;
+
+		// check for floor clip plane data
+		if (normal == Vec3() && distance == 0) return Mat4();
+
+		Mat4 rot = Mat4::rotation(Quat::rotation(Vec3(0, 1, 0), normal)); // rotation of plane
+		Mat4 trans = Mat4::translation(normal * -distance); // origin of plane
+		return rot * trans;
+	}
+
+	Vec3 Floor::closestPt(const Mat4& floor, const Vec3& pos) {
+
+		Vec3 o = floor.getTranslation();	// floor origin
+		Vec3 n = Vec3(floor(1, 0), floor(1, 1), floor(1, 2));	// floor normal, rotated y axis
+
+		// distance to floor = dot(orig-pt, normal)
+		float floorDist = (o - pos).dot(n);
+
+		return pos + n * floorDist;
+	}
+
+}
+}
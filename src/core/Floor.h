@@ -0,0 +1,37 @@
+#pragma once
+#include "Math3d.h"
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	// floor plane from the sensor's floor clip plane (normal x,y,z + height w)
+	// transform: floor space (y up, origin below the sensor) -> camera space, inverse cached
+	class Floor {
+	public:
+
+		Floor() {}
+		explicit Floor(const Vec4& floorClipPlane) { setPlane(floorClipPlane); }
+
+		void setPlane(const Vec4& floorClipPlane);
+		static Mat4 transformFromPlane(const Vec4& floorClipPlane); // identity if the plane is unknown (all 0)
+
+		const Mat4& getTransform() const	{ return _transform; }
+		const Mat4& getInverse() const		{ return _inverse; }
+		Vec3 getOrigin() const				{ return _transform.getTranslation(); }
+		Vec3 getNormal() const				{ return Vec3(_transform(1, 0), _transform(1, 1), _transform(1, 2)); } // y axis
+
+		Vec3 worldToFloor(const Vec3& pos) const	{ return pos * _inverse; }
+		Vec3 floorToWorld(const Vec3& pos) const	{ return pos * _transform; }
+
+		Vec3 closestPt(const Vec3& pos) const { return closestPt(_transform, pos); }	// camera space
+		Vec3 closestPtOnPlane(const Vec3& pos) const { return worldToFloor(closestPt(pos)); }	// floor space, y ~ 0
+		static Vec3 closestPt(const Mat4& floorTransform, const Vec3& pos);
+
+	protected:
+
+		Mat4 _transform;
+		Mat4 _inverse;
+	};
+
+}
+}
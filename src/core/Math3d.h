@@ -0,0 +1,216 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	// minimal vector math for the OF-free core, same layout & conventions as OF:
+	// row vectors (p * M), translation in row 3, M(r,c) = m[r][c], quaternions x,y,z,w
+	// (so ofVec3f / ofMatrix4x4 / ofQuaternion convert 1:1, see CoreAdapters.h)
+
+	struct Vec2 {
+		float x = 0, y = 0;
+		Vec2() {}
+		Vec2(float x, float y) : x(x), y(y) {}
+		Vec2 interpolated(const Vec2& to, float t) const { return Vec2(x * (1 - t) + to.x * t, y * (1 - t) + to.y * t); }
+	};
+
+	struct Vec3 {
+		float x = 0, y = 0, z = 0;
+		Vec3() {}
+		Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+		Vec3 operator+(const Vec3& v) const		{ return Vec3(x + v.x, y + v.y, z + v.z); }
+		Vec3 operator-(const Vec3& v) const		{ return Vec3(x - v.x, y - v.y, z - v.z); }
+		Vec3 operator*(float s) const			{ return Vec3(x * s, y * s, z * s); }
+		Vec3 operator/(float s) const			{ return Vec3(x / s, y / s, z / s); }
+		bool operator==(const Vec3& v) const	{ return x == v.x && y == v.y && z == v.z; }
+		bool operator!=(const Vec3& v) const	{ return !(*this == v); }
+
+		float dot(const Vec3& v) const			{ return x * v.x + y * v.y + z * v.z; }
+		Vec3 cross(const Vec3& v) const			{ return Vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+		float lengthSquared() const				{ return dot(*this); }
+		float length() const					{ return sqrtf(lengthSquared()); }
+		Vec3 middle(const Vec3& v) const		{ return Vec3((x + v.x) / 2, (y + v.y) / 2, (z + v.z) / 2); }
+		Vec3 interpolated(const Vec3& to, float t) const {
+			return Vec3(x * (1 - t) + to.x * t, y * (1 - t) + to.y * t, z * (1 - t) + to.z * t);
+		}
+	};
+
+	struct Vec4 {
+		float x = 0, y = 0, z = 0, w = 0;
+		Vec4() {}
+		Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+		float dot(const Vec4& v) const { return x * v.x + y * v.y + z * v.z + w * v.w; }
+	};
+
+	struct Quat {
+		float x = 0, y = 0, z = 0, w = 1;
+		Quat() {}
+		Quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+		Vec4 asVec4() const { return Vec4(x, y, z, w); }
+
+		// shortest rotation taking from onto to (ofQuaternion::makeRotate)
+		static Quat rotation(Vec3 from, Vec3 to) {
+			float fromLen2 = from.lengthSquared();
+			if (fromLen2 < 1.0 - 1e-7 || fromLen2 > 1.0 + 1e-7) from = from / sqrtf(fromLen2);
+			float toLen2 = to.lengthSquared();
+			if (toLen2 < 1.0 - 1e-7 || toLen2 > 1.0 + 1e-7) to = to / sqrtf(toLen2);
+
+			double dotPlus1 = 1.0 + from.dot(to);
+			if (dotPlus1 < 1e-7) { // opposite, any perpendicular axis
+				if (fabs(from.x) < 0.6) {
+					double norm = sqrt(1.0 - from.x * from.x);
+					return Quat(0, float(from.z / norm), float(-from.y / norm), 0);
+				}
+				if (fabs(from.y) < 0.6) {
+					double norm = sqrt(1.0 - from.y * from.y);
+					return Quat(float(-from.z / norm), 0, float(from.x / norm), 0);
+				}
+				double norm = sqrt(1.0 - from.z * from.z);
+				return Quat(float(from.y / norm), float(-from.x / norm), 0, 0);
+			}
+			double s = sqrt(0.5 * dotPlus1);
+			Vec3 v = from.cross(to) / float(2.0 * s);
+			return Quat(v.x, v.y, v.z, float(s));
+		}
+
+		// ofQuaternion::slerp
+		static Quat slerp(float t, const Quat& from, const Quat& to) {
+			double cosOmega = from.asVec4().dot(to.asVec4());
+			Quat q = to;
+			if (cosOmega < 0.0) {
+				cosOmega = -cosOmega;
+				q = Quat(-to.x, -to.y, -to.z, -to.w);
+			}
+			double scaleFrom, scaleTo;
+			if (1.0 - cosOmega > 0.00001) {
+				double omega = acos(cosOmega);
+				double sinOmega = sin(omega);
+				scaleFrom = sin((1.0 - t) * omega) / sinOmega;
+				scaleTo = sin(t * omega) / sinOmega;
+			}
+			else {
+				scaleFrom = 1.0 - t;
+				scaleTo = t;
+			}
+			return Quat(float(from.x * scaleFrom + q.x * scaleTo), float(from.y * scaleFrom + q.y * scaleTo),
+						float(from.z * scaleFrom + q.z * scaleTo), float(from.w * scaleFrom + q.w * scaleTo));
+		}
+	};
+
+	struct Mat4 {
+		float m[4][4];
+
+		Mat4() { makeIdentity(); }
+		explicit Mat4(const float* ptr) { memcpy(m, ptr, sizeof(m)); }
+
+		float& operator()(int r, int c)			{ return m[r][c]; }
+		float operator()(int r, int c) const	{ return m[r][c]; }
+		const float* getPtr() const				{ return &m[0][0]; }
+
+		void makeIdentity() {
+			memset(m, 0, sizeof(m));
+			m[0][0] = m[1][1] = m[2][2] = m[3][3] = 1;
+		}
+		bool isIdentity() const {
+			for (int r = 0; r < 4; r++) {
+				for (int c = 0; c < 4; c++) {
+					if (m[r][c] != (r == c ? 1.f : 0.f)) return false;
+				}
+			}
+			return true;
+		}
+
+		Mat4 operator*(const Mat4& b) const {
+			Mat4 r;
+			for (int i = 0; i < 4; i++) {
+				for (int j = 0; j < 4; j++) {
+					r.m[i][j] = m[i][0] * b.m[0][j] + m[i][1] * b.m[1][j] + m[i][2] * b.m[2][j] + m[i][3] * b.m[3][j];
+				}
+			}
+			return r;
+		}
+
+		Vec3 getTranslation() const { return Vec3(m[3][0], m[3][1], m[3][2]); }
+
+		static Mat4 translation(const Vec3& t) {
+			Mat4 r;
+			r.m[3][0] = t.x; r.m[3][1] = t.y; r.m[3][2] = t.z;
+			return r;
+		}
+
+		// ofMatrix4x4::makeRotationMatrix(quat)
+		static Mat4 rotation(const Quat& q) {
+			Mat4 r;
+			double len2 = q.asVec4().dot(q.asVec4());
+			if (len2 <= 1e-30) {
+				r.m[0][0] = r.m[1][1] = r.m[2][2] = 0;
+				return r;
+			}
+			double s = len2 != 1.0 ? 2.0 / len2 : 2.0;
+			double x2 = s * q.x, y2 = s * q.y, z2 = s * q.z;
+			double xx = q.x * x2, xy = q.x * y2, xz = q.x * z2;
+			double yy = q.y * y2, yz = q.y * z2, zz = q.z * z2;
+			double wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+			r.m[0][0] = float(1.0 - (yy + zz));	r.m[1][0] = float(xy - wz);			r.m[2][0] = float(xz + wy);
+			r.m[0][1] = float(xy + wz);			r.m[1][1] = float(1.0 - (xx + zz));	r.m[2][1] = float(yz - wx);
+			r.m[0][2] = float(xz - wy);			r.m[1][2] = float(yz + wx);			r.m[2][2] = float(1.0 - (xx + yy));
+			return r;
+		}
+
+		// general inverse (cofactors), identity if singular
+		Mat4 inverse() const {
+			const float* a = getPtr();
+			float inv[16];
+			inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+			inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+			inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+			inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+			inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+			inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+			inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+			inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+			inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+			inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+			inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+			inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+			inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+			inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+			inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+			inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+			float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+			if (det == 0) return Mat4();
+			for (int i = 0; i < 16; i++) inv[i] /= det;
+			return Mat4(inv);
+		}
+	};
+
+	// p * M, with perspective divide (ofMatrix4x4::preMult)
+	inline Vec3 operator*(const Vec3& v, const Mat4& m) {
+		float d = 1.0f / (m.m[0][3] * v.x + m.m[1][3] * v.y + m.m[2][3] * v.z + m.m[3][3]);
+		return Vec3((m.m[0][0] * v.x + m.m[1][0] * v.y + m.m[2][0] * v.z + m.m[3][0]) * d,
+					(m.m[0][1] * v.x + m.m[1][1] * v.y + m.m[2][1] * v.z + m.m[3][1]) * d,
+					(m.m[0][2] * v.x + m.m[1][2] * v.y + m.m[2][2] * v.z + m.m[3][2]) * d);
+	}
+
+	// reflection through plane (a,b,c,d), normal a,b,c unit length
+	inline Mat4 reflectionMatrix(const Vec4& plane) {
+		const double p[4] = { plane.x, plane.y, plane.z, plane.w };
+		Mat4 ref;
+		for (int c = 0; c < 3; c++) {
+			for (int r = 0; r < 3; r++) {
+				ref.m[r][c] = float((r == c ? 1. : 0.) - 2. * p[c] * p[r]);
+			}
+			ref.m[3][c] = float(-2. * p[3] * p[c]);
+			ref.m[c][3] = 0.;
+		}
+		ref.m[3][3] = 1.;
+		return ref;
+	}
+
+}
+}
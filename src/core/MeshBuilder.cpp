@@ -0,0 +1,248 @@
+#include "MeshBuilder.h"
+#include <algorithm>
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	void triangulate(const Vec3* vertices, const uint8_t* bodyIndex, int bodyId,
+					 int step, float facesMaxLength, std::vector<uint32_t>& indices) {
+
+		const int W = kDepthWidth, H = kDepthHeight;
+
+		// loop through body idx pix
+		//
+		// mesh triangle formatting:
+		//  tl.____t.
+		//    |\   /|
+		//    |  X  |
+		//  l.|/___\|
+		//          *i
+		//
+		std::vector<bool> isBody(W * H); // tracks body status in depth img
+
+		// loop through body idx px, find body px, add indices to mesh
+		for (int y = 0; y <= H - step; y += step) {
+			for (int x = 0; x <= W - step; x += step) {
+
+				// indices in body idx px
+				int i = y * W + x;
+				int t = i - W * step;
+				int l = i - step;
+				int tl = l - W * step;
+
+				// check if body idx color is this body
+				isBody[i] = bodyIndex[i] == bodyId;
+
+				if (t < 0 || l < 0) continue; // other points outside frame, move on
+
+				// check for triangles within body
+
+				// camera space points
+				const Vec3& v = vertices[i];
+				const Vec3& vT = vertices[t];
+				const Vec3& vL = vertices[l];
+				const Vec3& vTL = vertices[tl];
+
+				if (isBody[i] && !isBody[tl]) { // only one triangle option
+
+					if (isBody[t] && isBody[l]) {
+						// make triangle:
+						//   /|
+						// /__|
+
+						// check distance
+						if (v.z > 0 && vT.z > 0 && vL.z > 0
+							&& std::abs(v.z - vT.z) < facesMaxLength
+							&& std::abs(v.z - vL.z) < facesMaxLength) {
+							indices.push_back(i); indices.push_back(t); indices.push_back(l);
+						}
+					}
+				}
+				else if (isBody[tl] && !isBody[i]) { // only one triangle option
+
+					if (isBody[t] && isBody[l]) {
+						// make triangle:
+						// ____
+						// |  /
+						// |/
+
+						// check distance
+						if (vTL.z > 0 && vT.z > 0 && vL.z > 0
+							&& std::abs(vTL.z - vT.z) < facesMaxLength
+							&& std::abs(vTL.z - vL.z) < facesMaxLength) {
+							indices.push_back(tl); indices.push_back(t); indices.push_back(l);
+						}
+					}
+				}
+				else { // both i and tl are body, try inverted triangles
+					if (isBody[l]) {
+						// make triangle (no // art, a trailing \ continues the comment):
+						/* |\
+						   |__\ */
+
+						// check distance
+						if (v.z > 0 && vTL.z > 0 && vL.z > 0
+							&& std::abs(v.z - vTL.z) < facesMaxLength
+							&& std::abs(v.z - vL.z) < facesMaxLength) {
+							indices.push_back(i); indices.push_back(tl); indices.push_back(l);
+						}
+					}
+					if (isBody[t]) {
+						// make triangle:
+						// ____
+						// \  |
+						//   \|
+
+						// check distance
+						if (v.z > 0 && vTL.z > 0 && vT.z > 0
+							&& std::abs(v.z - vTL.z) < facesMaxLength
+							&& std::abs(v.z - vT.z) < facesMaxLength) {
+							indices.push_back(i); indices.push_back(tl); indices.push_back(t);
+						}
+					}
+				}
+			}
+		} // end loop through body idx pixels
+	}
+
+	void triangulateAdaptive(Vec3* vertices, Vec2* texCoords, const uint8_t* bodyIndex, const uint16_t* depth,
+							 int bodyId, int maxTriangles, float facesMaxLength, std::vector<uint32_t>& indices) {
+
+		const int W = kDepthWidth, H = kDepthHeight;
+
+		// block grid, vertices on block edges are shared with the neighbour
+		// (the last 15 columns / 7 rows of the depth img don't fill a block and are skipped)
+		const int B = 16;
+		const int bCols = (W - 1) / B;
+		const int bRows = (H - 1) / B;
+		const float focalPx = 365.5; // approx. kinect v2 depth focal length
+
+		// body px count & mean depth per block
+		int count[bCols * bRows] = {};
+		float meanZ[bCols * bRows] = {};
+		for (int by = 0; by < bRows; by++) {
+			for (int bx = 0; bx < bCols; bx++) {
+				int n = 0, sum = 0;
+				for (int y = by * B; y < (by + 1) * B; y++) {
+					for (int x = bx * B; x < (bx + 1) * B; x++) {
+						int i = y * W + x;
+						if (bodyIndex[i] == bodyId && depth[i]) { n++; sum += depth[i]; }
+					}
+				}
+				count[by * bCols + bx] = n;
+				meanZ[by * bCols + bx] = n ? sum * 0.001f / n : 0;
+			}
+		}
+
+		// step giving sample spacing ~s meters at depth z, power of 2
+		auto stepFor = [&](float s, float z) {
+			float px = s * focalPx / z;
+			int st = 1;
+			while (st < B && st * 2 <= px) st *= 2;
+			return st;
+		};
+		auto numTriangles = [&](float s) {
+			float n = 0;
+			for (int b = 0; b < bCols * bRows; b++) {
+				if (!count[b]) continue;
+				int st = stepFor(s, meanZ[b]);
+				n += 2.f * count[b] / (st * st);
+			}
+			return n;
+		};
+
+		// smallest spacing within budget
+		float lo = 0.0001f, hi = 1.f;
+		if (numTriangles(lo) <= maxTriangles) hi = lo;
+		for (int it = 0; it < 20 && hi > lo; it++) {
+			float mid = sqrtf(lo * hi);
+			if (numTriangles(mid) <= maxTriangles) hi = mid;
+			else lo = mid;
+		}
+		int steps[bCols * bRows];
+		for (int b = 0; b < bCols * bRows; b++) {
+			steps[b] = count[b] ? stepFor(hi, meanZ[b]) : 0;
+		}
+
+		// seams: where a finer block meets a coarser one, the fine block's extra edge vertices
+		// are moved onto the coarse edge so both sides agree (T-junctions without gaps)
+		auto snap = [&](int i, int a, int b, float t) {
+			if (vertices[a].z <= 0 || vertices[b].z <= 0 || vertices[i].z <= 0) return;
+			vertices[i] = vertices[a].interpolated(vertices[b], t);
+			texCoords[i] = texCoords[a].interpolated(texCoords[b], t);
+		};
+		for (int by = 0; by < bRows; by++) {
+			for (int bx = 0; bx < bCols; bx++) {
+				const int st = steps[by * bCols + bx];
+				if (!st) continue;
+				const int x0 = bx * B, y0 = by * B;
+
+				// right edge (x = x0 + B) against the right neighbour
+				if (bx + 1 < bCols) {
+					const int sn = steps[by * bCols + bx + 1];
+					const int fine = std::min(st, sn), coarse = std::max(st, sn);
+					if (sn && fine != coarse) {
+						for (int y = y0 + fine; y < y0 + B; y += fine) {
+							if (y % coarse == 0) continue;
+							int ya = y - y % coarse;
+							snap(y * W + x0 + B, ya * W + x0 + B, (ya + coarse) * W + x0 + B, (y - ya) / (float)coarse);
+						}
+					}
+				}
+				// bottom edge (y = y0 + B) against the neighbour below
+				if (by + 1 < bRows) {
+					const int sn = steps[(by + 1) * bCols + bx];
+					const int fine = std::min(st, sn), coarse = std::max(st, sn);
+					if (sn && fine != coarse) {
+						const int row = (y0 + B) * W;
+						for (int x = x0 + fine; x < x0 + B; x += fine) {
+							if (x % coarse == 0) continue;
+							int xa = x - x % coarse;
+							snap(row + x, row + xa, row + xa + coarse, (x - xa) / (float)coarse);
+						}
+					}
+				}
+			}
+		}
+
+		// triangulate each block with its own step
+		//
+		//  tl.____t.
+		//    |\   /|
+		//    |  X  |
+		//  l.|/___\|
+		//          *i
+		//
+		auto isBody = [&](int i) { return bodyIndex[i] == bodyId && vertices[i].z > 0; };
+		auto close = [&](int a, int b, int c) {
+			return std::abs(vertices[a].z - vertices[b].z) < facesMaxLength
+				&& std::abs(vertices[a].z - vertices[c].z) < facesMaxLength;
+		};
+		for (int by = 0; by < bRows; by++) {
+			for (int bx = 0; bx < bCols; bx++) {
+				const int st = steps[by * bCols + bx];
+				if (!st) continue;
+				for (int y = by * B + st; y <= (by + 1) * B; y += st) {
+					for (int x = bx * B + st; x <= (bx + 1) * B; x += st) {
+						int i = y * W + x;
+						int t = i - W * st;
+						int l = i - st;
+						int tl = l - W * st;
+						bool bI = isBody(i), bT = isBody(t), bL = isBody(l), bTL = isBody(tl);
+
+						if (bI && bTL) { // split along i-tl
+							if (bL && close(i, tl, l)) { indices.push_back(i); indices.push_back(tl); indices.push_back(l); }
+							if (bT && close(i, tl, t)) { indices.push_back(i); indices.push_back(tl); indices.push_back(t); }
+						}
+						else if (bT && bL) { // split along t-l
+							if (bI && close(i, t, l)) { indices.push_back(i); indices.push_back(t); indices.push_back(l); }
+							if (bTL && close(tl, t, l)) { indices.push_back(tl); indices.push_back(t); indices.push_back(l); }
+						}
+					}
+				}
+			}
+		}
+	}
+
+}
+}
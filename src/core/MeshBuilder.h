@@ -0,0 +1,28 @@
+#pragma once
+#include "Math3d.h"
+#include <vector>
+#include <cstdint>
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	// user mesh triangulation over the depth frame (512x424)
+	// vertices: depth frame mapped to camera space, one per depth px (z <= 0 = no depth)
+	// bodyIndex: body index frame, a px belongs to the user if it equals bodyId
+	// triangles are appended to indices, faces with an edge deeper than facesMaxLength (m) are dropped
+
+	const int kDepthWidth = 512;
+	const int kDepthHeight = 424;
+
+	// regular grid, every step px
+	void triangulate(const Vec3* vertices, const uint8_t* bodyIndex, int bodyId,
+					 int step, float facesMaxLength, std::vector<uint32_t>& indices);
+
+	// distance-adaptive: 16x16 px blocks pick a power of 2 step (1-16) for roughly even
+	// world space density, scaled to fit maxTriangles
+	// vertices & texCoords where a finer block meets a coarser one are snapped onto the coarse edge (no cracks)
+	void triangulateAdaptive(Vec3* vertices, Vec2* texCoords, const uint8_t* bodyIndex, const uint16_t* depth,
+							 int bodyId, int maxTriangles, float facesMaxLength, std::vector<uint32_t>& indices);
+
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// SSE2 is always there on x64 (and on x86 builds with /arch:SSE2),
+// everything using it keeps a scalar path for other targets
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define OFXKINECT2USER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 only when the project is built with /arch:AVX2 (or -mavx2)
+#if defined(__AVX2__)
+#define OFXKINECT2USER_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace ofxKinectForWindows2 {
+
+	// first px in row[x, end) that isn't background (body index 255), end if none
+	// 16 px per step with SSE2, for scans over mostly empty body index frames
+	inline int skipBackground(const unsigned char* row, int x, int end) {
+#ifdef OFXKINECT2USER_SSE2
+		const __m128i bg = _mm_set1_epi8((char)0xFF);
+		while (x + 16 <= end && _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(row + x)), bg)) == 0xFFFF) {
+			x += 16;
+		}
+#endif
+		while (x < end && row[x] == 255) x++;
+		return x;
+	}
+
+}
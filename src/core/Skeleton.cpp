@@ -0,0 +1,166 @@
+#include "Skeleton.h"
+#include "Simd.h"
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	namespace {
+
+		const int kLanes = 4;
+		const int kPadded = (kNumJoints + kLanes - 1) / kLanes * kLanes;
+
+		// one user's valid joints, SoA
+		struct JointsSoA {
+			alignas(16) float px[kPadded], py[kPadded], pz[kPadded];
+			alignas(16) float ox[kPadded], oy[kPadded], oz[kPadded], ow[kPadded];
+			int type[kNumJoints];
+			int n = 0;
+		};
+
+		// lerp against last frame (scalar, slerp), then gather into SoA
+		void gather(Joints& joints, const Joints* prev, float lerp, float inferLerp, JointsSoA& soa) {
+
+			soa.n = 0;
+			for (int type = 0; type < kNumJoints; type++) {
+
+				Joint& joint = joints[type];
+				if (!joint.valid) continue;
+
+				Vec3& p3dRaw = joint.posRaw;
+				Quat& oRaw = joint.orientationRaw;
+
+				float l = (joint.state == kTracked) ? lerp : inferLerp;
+
+				// lerp, must be 0-1
+				if (prev && (*prev)[type].valid && l > 0 && l < 1) {
+					const Joint& prevJoint = (*prev)[type];
+					p3dRaw = prevJoint.posRaw.interpolated(p3dRaw, l);
+					oRaw = Quat::slerp(l, prevJoint.orientationRaw, oRaw);
+				}
+
+				int i = soa.n++;
+				soa.type[i] = type;
+				soa.px[i] = p3dRaw.x; soa.py[i] = p3dRaw.y; soa.pz[i] = p3dRaw.z;
+				soa.ox[i] = oRaw.x; soa.oy[i] = oRaw.y; soa.oz[i] = oRaw.z; soa.ow[i] = oRaw.w;
+			}
+
+			// zero the tail lanes, they're transformed & dropped
+			for (int i = soa.n; i < (soa.n + kLanes - 1) / kLanes * kLanes; i++) {
+				soa.px[i] = soa.py[i] = soa.pz[i] = 0;
+				soa.ox[i] = soa.oy[i] = soa.oz[i] = soa.ow[i] = 0;
+			}
+		}
+
+		void scatter(const JointsSoA& soa, Joints& joints) {
+			for (int i = 0; i < soa.n; i++) {
+				Joint& joint = joints[soa.type[i]];
+				joint.pos = Vec3(soa.px[i], soa.py[i], soa.pz[i]);
+				joint.orientation = Quat(soa.ox[i], soa.oy[i], soa.oz[i], soa.ow[i]);
+			}
+		}
+
+		void negate(float* v, int n) {
+			for (int i = 0; i < n; i++) v[i] = -v[i];
+		}
+
+		void transformSkeleton(JointsSoA& soa, const SkeletonTransform& transform) {
+
+			const int n = (soa.n + kLanes - 1) / kLanes * kLanes;
+			if (!n) return;
+
+			// position: p * global (* reflection)
+			// the x mirror is a sign flip, folded into global's column 0 (-(a+b) == -a + -b, same values, zeros may flip sign)
+			if (transform.mirrorX && isMirrorXReflection(transform.reflection)) {
+				Mat4 m = transform.global;
+				for (int r = 0; r < 4; r++) m.m[r][0] = -m.m[r][0];
+				transformPoints(soa.px, soa.py, soa.pz, n, m);
+			}
+			else {
+				transformPoints(soa.px, soa.py, soa.pz, n, transform.global);
+				// any other mirror matrix doesn't compose exactly, second pass
+				if (transform.mirrorX) transformPoints(soa.px, soa.py, soa.pz, n, transform.reflection);
+			}
+
+			// orientation
+			if (transform.mirrorX) {
+				// mirror 3d orientation
+				negate(soa.ox, n);
+				negate(soa.ow, n);
+			}
+			else if (!transform.reflection.isIdentity()) {
+				transformPoints(soa.ox, soa.oy, soa.oz, n, transform.reflection);
+				negate(soa.ow, n); // fingers crossed...
+			}
+		}
+	}
+
+	bool isMirrorXReflection(const Mat4& m) {
+		// by value: reflectionMatrix() writes -0 into the translation row
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) {
+				if (m.m[r][c] != (r != c ? 0.f : c == 0 ? -1.f : 1.f)) return false;
+			}
+		}
+		return true;
+	}
+
+	void transformPoints(float* x, float* y, float* z, int n, const Mat4& m) {
+
+		int i = 0;
+
+#ifdef OFXKINECT2USER_SSE2
+		// same association as Vec3 * Mat4: ((m0 * x + m1 * y) + m2 * z) + m3, times 1 / w
+		const bool affine = m.m[0][3] == 0 && m.m[1][3] == 0 && m.m[2][3] == 0 && m.m[3][3] == 1; // w == 1, the divide is a no-op
+		__m128 m00 = _mm_set1_ps(m.m[0][0]), m10 = _mm_set1_ps(m.m[1][0]), m20 = _mm_set1_ps(m.m[2][0]), m30 = _mm_set1_ps(m.m[3][0]);
+		__m128 m01 = _mm_set1_ps(m.m[0][1]), m11 = _mm_set1_ps(m.m[1][1]), m21 = _mm_set1_ps(m.m[2][1]), m31 = _mm_set1_ps(m.m[3][1]);
+		__m128 m02 = _mm_set1_ps(m.m[0][2]), m12 = _mm_set1_ps(m.m[1][2]), m22 = _mm_set1_ps(m.m[2][2]), m32 = _mm_set1_ps(m.m[3][2]);
+		__m128 m03 = _mm_set1_ps(m.m[0][3]), m13 = _mm_set1_ps(m.m[1][3]), m23 = _mm_set1_ps(m.m[2][3]), m33 = _mm_set1_ps(m.m[3][3]);
+		const __m128 one = _mm_set1_ps(1.f);
+
+		for (; i + kLanes <= n; i += kLanes) {
+			__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+			__m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, vx), _mm_mul_ps(m10, vy)), _mm_mul_ps(m20, vz)), m30);
+			__m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, vx), _mm_mul_ps(m11, vy)), _mm_mul_ps(m21, vz)), m31);
+			__m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, vx), _mm_mul_ps(m12, vy)), _mm_mul_ps(m22, vz)), m32);
+			if (!affine) {
+				__m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m03, vx), _mm_mul_ps(m13, vy)), _mm_mul_ps(m23, vz)), m33);
+				__m128 d = _mm_div_ps(one, w);
+				rx = _mm_mul_ps(rx, d);
+				ry = _mm_mul_ps(ry, d);
+				rz = _mm_mul_ps(rz, d);
+			}
+			_mm_storeu_ps(x + i, rx);
+			_mm_storeu_ps(y + i, ry);
+			_mm_storeu_ps(z + i, rz);
+		}
+#endif
+
+		for (; i < n; i++) {
+			Vec3 p = Vec3(x[i], y[i], z[i]) * m;
+			x[i] = p.x; y[i] = p.y; z[i] = p.z;
+		}
+	}
+
+	void updateJoints(Joints& joints, const Joints* prev, float lerp, float inferLerp, const SkeletonTransform& transform) {
+		SkeletonUpdate update;
+		update.joints = &joints;
+		update.prev = prev;
+		update.lerp = lerp;
+		update.inferLerp = inferLerp;
+		update.transform = transform;
+		updateSkeletons(&update, 1);
+	}
+
+	void updateSkeletons(SkeletonUpdate* updates, int count) {
+		JointsSoA soa;
+		for (int u = 0; u < count; u++) {
+			SkeletonUpdate& update = updates[u];
+			if (!update.joints) continue;
+			gather(*update.joints, update.prev, update.lerp, update.inferLerp, soa);
+			transformSkeleton(soa, update.transform);
+			scatter(soa, *update.joints);
+		}
+	}
+
+}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "Math3d.h"
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	// per frame joint processing of a user: lerp against the last frame, user transform, mirroring / reflection
+	// joints are indexed by the sdk's JointType, tracking states use the sdk's TrackingState values
+
+	const int kNumJoints = 25;
+	enum { kNotTracked = 0, kInferred = 1, kTracked = 2 };
+
+	struct Joint {
+		bool valid = false;		// reported this frame
+		int state = kNotTracked;
+		Vec3 posRaw;			// kinect camera space (lerped)
+		Vec3 pos;				// transformed
+		Quat orientationRaw;
+		Quat orientation;
+	};
+
+	struct Joints {
+		Joint joints[kNumJoints];
+		Joint& operator[](int type)				{ return joints[type]; }
+		const Joint& operator[](int type) const	{ return joints[type]; }
+	};
+
+	struct SkeletonTransform {
+		Mat4 global;			// user transform (world scale & translate)
+		Mat4 reflection;		// identity if none
+		bool mirrorX = false;	// reflection is the yz plane, orientations mirrored around x
+	};
+
+	// joints: this frame's samples (valid, state, posRaw, orientationRaw), pos & orientation are filled in
+	// prev: last frame's result, nullptr for a new user (no lerp)
+	// lerp (tracked) / inferLerp (inferred) in 0-1, 1 = no smoothing
+	void updateJoints(Joints& joints, const Joints* prev, float lerp, float inferLerp, const SkeletonTransform& transform);
+
+	// one user for updateSkeletons()
+	struct SkeletonUpdate {
+		Joints* joints = nullptr;
+		const Joints* prev = nullptr;
+		float lerp = 1, inferLerp = 1;
+		SkeletonTransform transform;
+	};
+
+	// all users in one call, same results as updateJoints() per user
+	// each user's joints are one SoA batch (4 wide with SSE2) under that user's matrix,
+	// node & x mirror compose into one matrix per user
+	void updateSkeletons(SkeletonUpdate* updates, int count);
+
+	// SoA p * M in place, same order of operations (& results) as Vec3 * Mat4
+	void transformPoints(float* x, float* y, float* z, int n, const Mat4& m);
+
+	// reflectionMatrix(Vec4(1, 0, 0, 0)) (User::setMirrorX()), the mirror that folds into the node matrix
+	bool isMirrorXReflection(const Mat4& m);
+
+}
+}
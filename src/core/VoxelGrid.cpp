@@ -0,0 +1,73 @@
+#include "VoxelGrid.h"
+#include <algorithm>
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	VoxelGrid::VoxelGrid() {
+		_cells.assign(kMaxCells, 0);
+	}
+
+	int VoxelGrid::downsample(const Vec3* points, const uint32_t* colors, size_t n, const Vec3& min, const Vec3& max,
+							  float& voxelSize, int maxPoints) {
+
+		// grow voxels until the set fits maxPoints, count falls ~ with the square (surface)
+		int count = bin(points, colors, n, min, max, voxelSize);
+		for (int it = 0; it < 8 && maxPoints > 0 && count > maxPoints; it++) {
+			voxelSize *= std::max(1.05f, sqrtf(count / (float)maxPoints));
+			count = bin(points, colors, n, min, max, voxelSize);
+		}
+		if (maxPoints <= 0 || count <= maxPoints) return count;
+
+		// falls slower for lines & scattered px, keep an even stride so maxPoints stays a bound
+		for (int k = 0; k < maxPoints; k++) _voxels[k] = _voxels[(size_t)k * count / maxPoints];
+		_voxels.resize(maxPoints);
+		return maxPoints;
+	}
+
+	int VoxelGrid::bin(const Vec3* points, const uint32_t* colors, size_t n, const Vec3& min, const Vec3& max, float& voxelSize) {
+
+		_voxels.clear();
+
+		// dense grid over the bounds, coarser if it wouldn't fit
+		const Vec3 ext = max - min;
+		int nx, ny, nz;
+		while (true) {
+			nx = (int)(ext.x / voxelSize) + 1;
+			ny = (int)(ext.y / voxelSize) + 1;
+			nz = (int)(ext.z / voxelSize) + 1;
+			if ((long long)nx * ny * nz <= kMaxCells) break;
+			voxelSize *= 1.25f;
+		}
+
+		const float inv = 1.f / voxelSize;
+		for (size_t k = 0; k < n; k++) {
+			const Vec3& p = points[k];
+			int ix = std::min(nx - 1, (int)((p.x - min.x) * inv));
+			int iy = std::min(ny - 1, (int)((p.y - min.y) * inv));
+			int iz = std::min(nz - 1, (int)((p.z - min.z) * inv));
+			int cell = (iz * ny + iy) * nx + ix;
+
+			int& slot = _cells[cell];
+			if (!slot) {
+				_voxels.push_back({ cell, 0, 0, 0, 0, 0, 0, 0, 0 });
+				slot = (int)_voxels.size();
+			}
+			Voxel& v = _voxels[slot - 1];
+			v.n++;
+			v.x += p.x; v.y += p.y; v.z += p.z;
+			if (colors && (colors[k] >> 24)) {
+				v.nColor++;
+				v.r += colors[k] & 0xFF;
+				v.g += (colors[k] >> 8) & 0xFF;
+				v.b += (colors[k] >> 16) & 0xFF;
+			}
+		}
+
+		// leave the grid empty for the next call
+		for (auto& v : _voxels) _cells[v.cell] = 0;
+		return (int)_voxels.size();
+	}
+
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Math3d.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ofxKinectForWindows2 {
+namespace core {
+
+	// voxel downsampling of one point set, used per user by UserPointCloud
+	// dense grid over the points' bounds (no hashing, only touched cells are reset)
+	// every voxel becomes one point: centroid + average color
+
+	struct Voxel {
+		int cell;
+		int n, nColor;
+		float x, y, z;
+		float r, g, b;
+	};
+
+	class VoxelGrid {
+	public:
+
+		VoxelGrid();
+
+		// colors: RGBA per point, alpha 0 = no color, nullptr for none
+		// voxels grow from voxelSize (updated to the size used) until there are at most maxPoints (0 = no limit),
+		// a set that still has more after that (thin / sparse shapes) keeps an even stride of maxPoints voxels
+		// returns # voxels, always <= maxPoints
+		int downsample(const Vec3* points, const uint32_t* colors, size_t n, const Vec3& min, const Vec3& max,
+					   float& voxelSize, int maxPoints);
+		const std::vector<Voxel>& getVoxels() const { return _voxels; }
+
+		static const int kMaxCells = 1 << 18; // 2 x 1 x 0.5 m at 2 cm is 125k
+
+	protected:
+
+		int bin(const Vec3* points, const uint32_t* colors, size_t n, const Vec3& min, const Vec3& max, float& voxelSize);
+
+		std::vector<int> _cells;	// dense grid, voxel index + 1, 0 = empty (all empty between calls)
+		std::vector<Voxel> _voxels;
+	};
+
+}
+}
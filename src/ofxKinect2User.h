@@ -1,4 +1,10 @@
 #pragma once
 
 #include "Kinect.h"
-#include "User.h"
\ No newline at end of file
+#include "User.h"
+#include "OccupancyMap.h"
+#include "UserContour.h"
+#include "BatchProcessor.h"
+#include "SkeletonArchive.h"
+#include "UserCache.h"
+#include "UserPointCloud.h"
\ No newline at end of file
@@ -0,0 +1,227 @@
+// smoke test of the OF-free core: floor, skeleton & mesh builder round trips
+// built by src/core/CMakeLists.txt, returns non-zero on failure
+
+#include "Floor.h"
+#include "Skeleton.h"
+#include "MeshBuilder.h"
+#include "VoxelGrid.h"
+#include <cstdio>
+#include <vector>
+
+using namespace ofxKinectForWindows2::core;
+
+namespace {
+
+	int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+	bool near(float a, float b, float eps = 1e-4f) { return std::abs(a - b) <= eps; }
+	bool near(const Vec3& a, const Vec3& b, float eps = 1e-4f) { return near(a.x, b.x, eps) && near(a.y, b.y, eps) && near(a.z, b.z, eps); }
+
+	void testFloor() {
+
+		// sensor 1 m above the floor, tilted down a bit
+		Vec4 plane(0, 0.98f, 0.199f, 1.1f);
+		float len = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane = Vec4(plane.x / len, plane.y / len, plane.z / len, plane.w);
+		Floor floor(plane);
+
+		CHECK(!floor.getTransform().isIdentity());
+		CHECK(Floor::transformFromPlane(Vec4()).isIdentity()); // unknown plane
+
+		Vec3 p(0.3f, 0.2f, 2.5f);
+		CHECK(near(floor.floorToWorld(floor.worldToFloor(p)), p));
+
+		// closest point lies on the plane, straight below p
+		Vec3 c = floor.closestPt(p);
+		Vec3 n(plane.x, plane.y, plane.z);
+		CHECK(near(n.dot(c) + plane.w, 0));
+		CHECK(near((p - c).cross(n).length(), 0));
+		CHECK(near(floor.closestPtOnPlane(p).y, 0));
+	}
+
+	void testSkeleton() {
+
+		Joints joints;
+		for (int j = 0; j < kNumJoints; j++) {
+			if (j == 3) continue; // one joint missing
+			joints[j].valid = true;
+			joints[j].state = kTracked;
+			joints[j].posRaw = Vec3(0.1f * j, 1 - 0.05f * j, 2 + 0.01f * j);
+			joints[j].orientationRaw = Quat(0.1f, 0.2f, 0.3f, sqrtf(1 - 0.14f));
+		}
+
+		// identity: raw in, raw out
+		{
+			Joints cur = joints;
+			updateJoints(cur, nullptr, 1, 1, SkeletonTransform());
+			for (int j = 0; j < kNumJoints; j++) {
+				if (!cur[j].valid) continue;
+				CHECK(cur[j].pos == joints[j].posRaw);
+				CHECK(cur[j].orientation.w == joints[j].orientationRaw.w);
+			}
+			CHECK(!cur[3].valid);
+		}
+
+		// lerp half way against last frame
+		{
+			Joints prev = joints, cur = joints;
+			for (int j = 0; j < kNumJoints; j++) prev[j].posRaw = joints[j].posRaw + Vec3(0.2f, 0, 0);
+			updateJoints(cur, &prev, 0.5f, 0.5f, SkeletonTransform());
+			CHECK(near(cur[0].posRaw, joints[0].posRaw + Vec3(0.1f, 0, 0)));
+		}
+
+		// world scale & translate, then mirrored around x
+		{
+			SkeletonTransform transform;
+			transform.global(0, 0) = transform.global(1, 1) = transform.global(2, 2) = 2;
+			transform.global(3, 0) = 0.5f;
+			transform.reflection = reflectionMatrix(Vec4(1, 0, 0, 0));
+			transform.mirrorX = true;
+
+			Joints cur = joints;
+			updateJoints(cur, nullptr, 1, 1, transform);
+			const Joint& j = cur[5];
+			CHECK(near(j.pos, Vec3(-(2 * j.posRaw.x + 0.5f), 2 * j.posRaw.y, 2 * j.posRaw.z)));
+			CHECK(j.orientation.x == -j.orientationRaw.x && j.orientation.y == j.orientationRaw.y);
+			CHECK(j.orientation.z == j.orientationRaw.z && j.orientation.w == -j.orientationRaw.w);
+		}
+	}
+
+	// the x mirror folds into the node matrix (one pass), results must equal p * global * reflection
+	void testMirrorFold() {
+
+		CHECK(isMirrorXReflection(reflectionMatrix(Vec4(1, 0, 0, 0)))); // as User::setMirrorX() builds it (-0 row)
+		CHECK(!isMirrorXReflection(reflectionMatrix(Vec4(0.6f, 0.8f, 0, 0))));
+		CHECK(!isMirrorXReflection(Mat4()));
+
+		const Vec4 planes[] = { Vec4(1, 0, 0, 0), Vec4(0.6f, 0.8f, 0, 0.3f) }; // folded, two passes
+		for (const Vec4& plane : planes) {
+			for (int affine = 0; affine < 2; affine++) {
+
+				SkeletonTransform transform;
+				transform.global = Mat4::rotation(Quat(0.1f, 0.3f, -0.2f, 0.927f)) * Mat4::translation(Vec3(0.5f, -0.25f, 1.5f));
+				transform.global(0, 0) *= 1.7f;
+				if (!affine) transform.global(1, 3) = 0.01f;
+				transform.reflection = reflectionMatrix(plane);
+				transform.mirrorX = true;
+
+				Joints cur;
+				for (int j = 0; j < kNumJoints; j++) {
+					cur[j].valid = true;
+					cur[j].posRaw = Vec3(0.37f * j - 4, 1.3f - 0.11f * j, 0.5f + 0.23f * j);
+				}
+				updateJoints(cur, nullptr, 1, 1, transform);
+
+				for (int j = 0; j < kNumJoints; j++) {
+					Vec3 expected = (cur[j].posRaw * transform.global) * transform.reflection;
+					CHECK(cur[j].pos == expected); // by value, exact
+				}
+			}
+		}
+	}
+
+	void testMeshBuilder() {
+
+		// flat 40x30 px body at 2 m, everything else background without depth
+		std::vector<Vec3> vertices(kDepthWidth * kDepthHeight);
+		std::vector<uint8_t> bodyIndex(kDepthWidth * kDepthHeight, 255);
+		std::vector<uint16_t> depth(kDepthWidth * kDepthHeight, 0);
+		const int x0 = 200, y0 = 150, w = 40, h = 30;
+		for (int y = y0; y < y0 + h; y++) {
+			for (int x = x0; x < x0 + w; x++) {
+				int i = y * kDepthWidth + x;
+				bodyIndex[i] = 2;
+				depth[i] = 2000;
+				vertices[i] = Vec3((x - 256) * 0.0028f * 2, (212 - y) * 0.0028f * 2, 2);
+			}
+		}
+
+		auto allOnBody = [&](const std::vector<uint32_t>& indices) {
+			for (uint32_t i : indices) {
+				if (i >= bodyIndex.size() || bodyIndex[i] != 2) return false;
+			}
+			return true;
+		};
+
+		std::vector<uint32_t> indices;
+		triangulate(vertices.data(), bodyIndex.data(), 2, 1, 0.1f, indices);
+		CHECK(indices.size() == 3u * 2 * (w - 1) * (h - 1)); // full grid, two triangles per quad
+		CHECK(allOnBody(indices));
+
+		indices.clear();
+		triangulate(vertices.data(), bodyIndex.data(), 1, 1, 0.1f, indices); // other body id
+		CHECK(indices.empty());
+
+		std::vector<Vec2> texCoords(vertices.size());
+		indices.clear();
+		triangulateAdaptive(vertices.data(), texCoords.data(), bodyIndex.data(), depth.data(), 2, 500, 0.1f, indices);
+		CHECK(!indices.empty());
+		CHECK(indices.size() % 3 == 0);
+		CHECK(indices.size() <= 3u * 500);
+		CHECK(allOnBody(indices));
+	}
+
+	// maxPoints is a bound: a full frame body and a thin line (count falls slowly as voxels grow) both fit it
+	void testVoxelGrid() {
+
+		VoxelGrid grid;
+		auto downsample = [&](const std::vector<Vec3>& pts, float& voxelSize, int maxPoints) {
+			Vec3 mn = pts[0], mx = pts[0];
+			for (const Vec3& p : pts) {
+				mn = Vec3(std::min(mn.x, p.x), std::min(mn.y, p.y), std::min(mn.z, p.z));
+				mx = Vec3(std::max(mx.x, p.x), std::max(mx.y, p.y), std::max(mx.z, p.z));
+			}
+			return grid.downsample(pts.data(), nullptr, pts.size(), mn, mx, voxelSize, maxPoints);
+		};
+
+		// every depth px on a 2 x 1.7 m body at 2-3 m
+		std::vector<Vec3> body;
+		for (int y = 0; y < kDepthHeight; y++) {
+			for (int x = 0; x < kDepthWidth; x++) {
+				body.push_back(Vec3((x - 256) * 0.004f, (212 - y) * 0.004f, 2 + 0.002f * ((x * 7 + y * 13) % 500)));
+			}
+		}
+		float voxelSize = 0.02f;
+		int n = downsample(body, voxelSize, 4000);
+		CHECK(n > 0 && n <= 4000);
+		CHECK((int)grid.getVoxels().size() == n);
+		CHECK(voxelSize > 0.02f);
+
+		std::vector<Vec3> line;
+		for (int i = 0; i < 20000; i++) line.push_back(Vec3(i * 0.0002f, 1, 2));
+		voxelSize = 0.0005f;
+		n = downsample(line, voxelSize, 100);
+		CHECK(n > 0 && n <= 100);
+
+		// 105 separate blobs 0.5 m apart: growing voxels can't merge them, output gets strided
+		std::vector<Vec3> blobs;
+		for (int b = 0; b < 105; b++) {
+			Vec3 c((b % 5) * 0.5f, (b / 5 % 3) * 0.5f, 1 + (b / 15) * 0.5f);
+			for (int i = 0; i < 50; i++) blobs.push_back(c + Vec3(0.001f * (i % 5), 0.001f * (i / 5 % 5), 0.001f * (i / 25)));
+		}
+		voxelSize = 0.02f;
+		n = downsample(blobs, voxelSize, 100);
+		CHECK(n == 100);
+		CHECK((int)grid.getVoxels().size() == n);
+		for (const Voxel& v : grid.getVoxels()) CHECK(v.n > 0 && v.n <= 50); // never merged across blobs
+
+		voxelSize = 0.02f;
+		n = downsample(body, voxelSize, 0); // no limit
+		CHECK(n > 4000);
+	}
+}
+
+int main() {
+
+	testFloor();
+	testSkeleton();
+	testMirrorFold();
+	testMeshBuilder();
+	testVoxelGrid();
+
+	if (failures) printf("%d check(s) failed\n", failures);
+	else printf("core smoke test passed\n");
+	return failures ? 1 : 0;
+}